@@ -41,6 +41,12 @@ struct carl9170_bar_ctx {
 	__le16 control;
 };
 
+struct carl9170_rx_dup_ctx {
+	uint16_t ta[3];
+	__le16 seq_ctrl;
+	uint8_t tid;
+};
+
 enum carl9170_cab_trigger {
 	CARL9170_CAB_TRIGGER_EMPTY	= 0,
 	CARL9170_CAB_TRIGGER_ARMED	= BIT(0),
@@ -104,23 +110,132 @@ struct firmware_context_struct {
 		struct carl9170_tx_superframe *ampdu_prev[__AR9170_NUM_TX_QUEUES];
 
 		/* Hardware DMA queue unstuck/fix detection */
-		unsigned int last_super_num[__AR9170_NUM_TX_QUEUES];
+		unsigned int last_super_time[__AR9170_NUM_TX_QUEUES];
 		struct carl9170_tx_superframe *last_super[__AR9170_NUM_TX_QUEUES];
+		unsigned int hang_detect_time[__AR9170_NUM_TX_QUEUES];
+		unsigned int hang_check_time;
+		unsigned int hang_detected,
+			     hang_reset;
+#ifdef CONFIG_CARL9170FW_DEBUG
+		unsigned int hang_dumped;
+#endif /* CONFIG_CARL9170FW_DEBUG */
+		unsigned int hang_bump_usecs,
+			     hang_debug_usecs,
+			     hang_reset_usecs;
 		unsigned int mac_reset;
+		unsigned int mac_reset_cause;
 		unsigned int soft_int;
 
 		/* rx filter */
 		unsigned int rx_filter;
 
+		/* rx duplicate detection */
+		struct carl9170_rx_dup_ctx rx_dup_cache[CARL9170_RX_DUP_CACHE_NUM];
+		unsigned int rx_dup_idx;
+
+		/* beacon change filter */
+		unsigned int bcn_filter_flags,
+			     bcn_filter_aid,
+			     bcn_filter_keepalive;
+		uint32_t bcn_filter_hash;
+		unsigned int bcn_filter_time;
+
+		/* multicast filter */
+		uint32_t mcast_addr[CARL9170_MCAST_FILTER_NUM][2];
+		unsigned int mcast_num;
+
+		/* rx frames in the up_queue */
+		unsigned int rx_up_pending;
+
+#ifdef CONFIG_CARL9170FW_RX_TSF
+		unsigned int rx_tsf;
+#endif /* CONFIG_CARL9170FW_RX_TSF */
+
+#ifdef CONFIG_CARL9170FW_RX_DECAP
+		unsigned int rx_decap;
+#endif /* CONFIG_CARL9170FW_RX_DECAP */
+
+#ifdef CONFIG_CARL9170FW_RX_BALANCE
+		/* tx blocks in the rx pool, still to be lent and on their way back */
+		unsigned int rx_lent;
+		unsigned int rx_lend;
+		unsigned int rx_return;
+		unsigned int rx_overrun_ticks;
+		unsigned int tx_pressure_ticks;
+#endif /* CONFIG_CARL9170FW_RX_BALANCE */
+
+#ifdef CONFIG_CARL9170FW_RX_TRUNCATE
+		unsigned int rx_truncate;
+#endif /* CONFIG_CARL9170FW_RX_TRUNCATE */
+
+#ifdef CONFIG_CARL9170FW_RX_STA_TABLE
+		/* rx station slots with a valid rssi average */
+		unsigned int rx_sta_rssi;
+#endif /* CONFIG_CARL9170FW_RX_STA_TABLE */
+
+#ifdef CONFIG_CARL9170FW_RX_TEST
+		unsigned int rx_test;
+		uint32_t rx_test_phy;
+#endif /* CONFIG_CARL9170FW_RX_TEST */
+
 		/* tx sequence control counters */
 		unsigned int sequence[CARL9170_INTF_NUM];
 
 		/* CAB */
 		struct dma_queue cab_queue[CARL9170_INTF_NUM];
 		unsigned int cab_queue_len[CARL9170_INTF_NUM];
-		unsigned int cab_flush_time;
+		unsigned int cab_flush_time[CARL9170_INTF_NUM];
+		unsigned int cab_armed;
+		unsigned int pretbtt_time;
 		enum carl9170_cab_trigger cab_flush_trigger[CARL9170_INTF_NUM];
 
+#ifdef CONFIG_CARL9170FW_PS_POLL_OFFLOAD
+		/* PS-Poll and U-APSD hold queues */
+		struct dma_queue ps_queue[CARL9170_PS_STA_NUM][__AR9170_NUM_TXQ];
+		unsigned int ps_queue_len[CARL9170_PS_STA_NUM][__AR9170_NUM_TXQ];
+		unsigned int ps_aid[CARL9170_PS_STA_NUM];
+		unsigned int ps_uapsd[CARL9170_PS_STA_NUM];
+		unsigned int ps_max_sp[CARL9170_PS_STA_NUM];
+		uint32_t ps_addr[CARL9170_PS_STA_NUM][2];
+		unsigned int ps_poll_time[CARL9170_PS_STA_NUM];
+		unsigned int ps_pending;
+		unsigned int ps_sp;
+		struct carl9170_tx_superframe *ps_sp_end[CARL9170_PS_STA_NUM];
+#endif /* CONFIG_CARL9170FW_PS_POLL_OFFLOAD */
+
+#ifdef CONFIG_CARL9170FW_PROBE_RESP_OFFLOAD
+		/* probe response templates, the SSID IE is NULL when unused */
+		const uint8_t *probe_ssid[CARL9170_INTF_NUM];
+		uint32_t probe_phy[CARL9170_INTF_NUM];
+#endif /* CONFIG_CARL9170FW_PROBE_RESP_OFFLOAD */
+
+#ifdef CONFIG_CARL9170FW_TX_FLOW
+		/* template lengths, 0 when the flow is unused */
+		uint8_t tx_flow_len[CARL9170_TX_FLOW_NUM];
+#endif /* CONFIG_CARL9170FW_TX_FLOW */
+
+#ifdef CONFIG_CARL9170FW_TX_AMSDU
+		uint32_t amsdu_addr[CARL9170_AMSDU_STA_NUM][2];
+		unsigned int amsdu_max_len[CARL9170_AMSDU_STA_NUM];
+
+		/* first frame of the A-MSDU, which is being put together */
+		struct dma_desc *amsdu_pending;
+		unsigned int amsdu_sta;
+		unsigned int amsdu_len;
+#endif /* CONFIG_CARL9170FW_TX_AMSDU */
+
+#ifdef CONFIG_CARL9170FW_TXOP_BURST
+		/* frame limit and the frames in the current burst */
+		unsigned int txop_frames[__AR9170_NUM_TXQ];
+		unsigned int txop_burst[__AR9170_NUM_TXQ];
+#endif /* CONFIG_CARL9170FW_TXOP_BURST */
+
+		/* firmware maintained beacon templates */
+		unsigned int bcn_tmpl_addr[CARL9170_INTF_NUM];
+		unsigned int bcn_tmpl_len[CARL9170_INTF_NUM];
+		unsigned int bcn_tmpl_fresh;
+		unsigned int bcn_tmpl_next;
+
 		/* tx status */
 		unsigned int tx_status_pending,
 			     tx_status_head_idx,
@@ -140,6 +255,13 @@ struct firmware_context_struct {
 			     queued_ba;
 
 		unsigned int queued_bar;
+
+#ifdef CONFIG_CARL9170FW_ADAPTIVE_PROTECTION
+		/* adaptive RTS/CTS protection */
+		unsigned int prot_enabled;
+		unsigned int prot_samples[__AR9170_NUM_TX_QUEUES];
+		unsigned int prot_failures[__AR9170_NUM_TX_QUEUES];
+#endif /* CONFIG_CARL9170FW_ADAPTIVE_PROTECTION */
 	} wlan;
 
 	struct {
@@ -169,6 +291,10 @@ struct firmware_context_struct {
 		struct dma_desc *int_desc;
 		struct carl9170_rsp int_buf[CARL9170_INT_RQ_CACHES];
 
+#ifdef CONFIG_CARL9170FW_USB_LOOPBACK
+		unsigned int loopback;
+#endif /* CONFIG_CARL9170FW_USB_LOOPBACK */
+
 #ifdef CONFIG_CARL9170FW_DEBUG_USB
 		/* USB printf */
 		unsigned int put_index;
@@ -194,6 +320,51 @@ struct firmware_context_struct {
 	struct carl9170_tally_rsp tally;
 	unsigned int tx_time;
 
+	struct {
+		struct carl9170_cab_stats cab[CARL9170_INTF_NUM];
+		struct carl9170_hang_stats hang[__AR9170_NUM_TX_QUEUES];
+		struct carl9170_rx_filter_stats rx_filter[CARL9170_RX_FILTER_CLASSES];
+		struct carl9170_mcast_stats mcast;
+		struct carl9170_rx_congestion_stats rx_congestion;
+#ifdef CONFIG_CARL9170FW_RX_DECAP
+		struct carl9170_rx_decap_stats rx_decap;
+#endif /* CONFIG_CARL9170FW_RX_DECAP */
+#ifdef CONFIG_CARL9170FW_PS_POLL_OFFLOAD
+		struct carl9170_ps_stats ps[CARL9170_PS_STA_NUM];
+#endif /* CONFIG_CARL9170FW_PS_POLL_OFFLOAD */
+#ifdef CONFIG_CARL9170FW_RX_BALANCE
+		struct carl9170_rx_balance_stats rx_balance;
+#endif /* CONFIG_CARL9170FW_RX_BALANCE */
+#ifdef CONFIG_CARL9170FW_PROBE_RESP_OFFLOAD
+		struct carl9170_probe_resp_stats probe_resp[CARL9170_INTF_NUM];
+#endif /* CONFIG_CARL9170FW_PROBE_RESP_OFFLOAD */
+#ifdef CONFIG_CARL9170FW_TX_FLOW
+		struct carl9170_tx_flow_stats tx_flow;
+#endif /* CONFIG_CARL9170FW_TX_FLOW */
+#ifdef CONFIG_CARL9170FW_TX_AMSDU
+		struct carl9170_tx_amsdu_stats tx_amsdu;
+#endif /* CONFIG_CARL9170FW_TX_AMSDU */
+#ifdef CONFIG_CARL9170FW_TXOP_BURST
+		struct carl9170_txop_stats txop;
+#endif /* CONFIG_CARL9170FW_TXOP_BURST */
+#ifdef CONFIG_CARL9170FW_FW_MAC_RESET
+		struct carl9170_mac_reset_stats mac_reset;
+#endif /* CONFIG_CARL9170FW_FW_MAC_RESET */
+#ifdef CONFIG_CARL9170FW_PATTERN_GENERATOR
+		struct carl9170_pgen_stats pgen;
+#endif /* CONFIG_CARL9170FW_PATTERN_GENERATOR */
+#ifdef CONFIG_CARL9170FW_ADAPTIVE_PROTECTION
+		struct carl9170_prot_stats prot[__AR9170_NUM_TX_QUEUES];
+#endif /* CONFIG_CARL9170FW_ADAPTIVE_PROTECTION */
+#ifdef CONFIG_CARL9170FW_RX_TEST
+		struct carl9170_rx_test_stats rx_test;
+		struct carl9170_rx_rate_stats rx_rates[__CARL9170_RX_RATE_NUM];
+#endif /* CONFIG_CARL9170FW_RX_TEST */
+#ifdef CONFIG_CARL9170FW_USB_LOOPBACK
+		struct carl9170_loopback_stats loopback;
+#endif /* CONFIG_CARL9170FW_USB_LOOPBACK */
+	} stats;
+
 #ifdef CONFIG_CARL9170FW_WOL
 	struct {
 		struct carl9170_wol_cmd cmd;
@@ -204,6 +375,17 @@ struct firmware_context_struct {
 	} wol;
 #endif /* CONFIG_CARL9170FW_WOL */
 
+#ifdef CONFIG_CARL9170FW_PATTERN_GENERATOR
+	struct {
+		struct dma_desc *free[CARL9170_PGEN_DESC_NUM];
+		unsigned int free_num;
+		unsigned int running;
+		unsigned int remaining;
+		unsigned int interval;
+		unsigned int last;
+	} pgen;
+#endif /* CONFIG_CARL9170FW_PATTERN_GENERATOR */
+
 #ifdef CONFIG_CARL9170FW_GPIO_INTERRUPT
 	struct carl9170_gpio cached_gpio_state;
 #endif /*CONFIG_CARL9170FW_GPIO_INTERRUPT */
@@ -47,6 +47,41 @@ static inline void __check(void)
 	BUILD_BUG_ON(sizeof(struct carl9170_gpio) != CARL9170_GPIO_SIZE);
 	BUILD_BUG_ON(sizeof(struct carl9170_rx_filter_cmd) != CARL9170_RX_FILTER_CMD_SIZE);
 	BUILD_BUG_ON(sizeof(struct carl9170_wol_cmd) != CARL9170_WOL_CMD_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_stats_cmd) != CARL9170_STATS_CMD_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_cab_stats) != CARL9170_CAB_STATS_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_prot_stats) != CARL9170_PROT_STATS_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_hang_stats) != CARL9170_HANG_STATS_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_mac_reset_stats) != CARL9170_MAC_RESET_STATS_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_pgen_cmd) != CARL9170_PGEN_CMD_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_pgen_rsp) != CARL9170_PGEN_RSP_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_pgen_stats) != CARL9170_PGEN_STATS_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_loopback_stats) != CARL9170_LOOPBACK_STATS_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_bcn_filter_cmd) != CARL9170_BCN_FILTER_CMD_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_mcast_filter_cmd) != CARL9170_MCAST_FILTER_CMD_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_rx_sta_stats) != CARL9170_RX_STA_STATS_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_rx_sta_rate_stats) != CARL9170_RX_STA_RATE_STATS_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_ps_sta_cmd) != CARL9170_PS_STA_CMD_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_ps_stats) != CARL9170_PS_STATS_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_probe_resp_cmd) != CARL9170_PROBE_RESP_CMD_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_probe_resp_rsp) != CARL9170_PROBE_RESP_RSP_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_probe_resp_stats) != CARL9170_PROBE_RESP_STATS_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_rx_balance_stats) != CARL9170_RX_BALANCE_STATS_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_rx_congestion_stats) != CARL9170_RX_CONGESTION_STATS_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_rx_decap_stats) != CARL9170_RX_DECAP_STATS_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_tx_flow_cmd) != CARL9170_TX_FLOW_CMD_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_tx_flow_rsp) != CARL9170_TX_FLOW_RSP_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_tx_flow_stats) != CARL9170_TX_FLOW_STATS_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_rate_tbl_cmd) != CARL9170_RATE_TBL_CMD_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_amsdu_sta_cmd) != CARL9170_AMSDU_STA_CMD_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_tx_amsdu_stats) != CARL9170_TX_AMSDU_STATS_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_txop_cmd) != CARL9170_TXOP_CMD_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_txop_stats) != CARL9170_TXOP_STATS_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_mcast_stats) != CARL9170_MCAST_STATS_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_rx_filter_stats) != CARL9170_RX_FILTER_STATS_SIZE);
+	BUILD_BUG_ON(CARL9170_RX_FILTER_LAST != BIT(CARL9170_RX_FILTER_CLASSES - 1));
+	BUILD_BUG_ON(sizeof(struct carl9170_rx_test_stats) != CARL9170_RX_TEST_STATS_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_rx_rate_stats) != CARL9170_RX_RATE_STATS_SIZE);
+	BUILD_BUG_ON(sizeof(struct carl9170_param_cmd) != CARL9170_PARAM_CMD_SIZE);
 }
 
 void handle_cmd(struct carl9170_rsp *resp);
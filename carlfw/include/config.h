@@ -43,6 +43,59 @@
 #define AR9170_INT_MAGIC_HEADER_SIZE	12
 #define CARL9170_TBTT_DELTA		(CARL9170_PRETBTT_KUS + 1)
 
+/* TX hang detection: check interval and default thresholds */
+#define CARL9170_HANG_CHECK_USECS	1000
+#define CARL9170_HANG_BUMP_USECS	100000
+#define CARL9170_HANG_DEBUG_USECS	150000
+#define CARL9170_HANG_RESET_USECS	175000
+
+/* the 32-bit clock counter wraps after ~48s with the 88MHz AHB clock */
+#define CARL9170_AHB_MAX_MHZ		88
+#define CARL9170_CLOCK_WRAP_USECS	(0xffffffffU / CARL9170_AHB_MAX_MHZ)
+#define CARL9170_HANG_MAX_USECS		(CARL9170_CLOCK_WRAP_USECS - \
+					 CARL9170_HANG_CHECK_USECS)
+
+/* pattern generator template size and frames in flight */
+#define CARL9170_PGEN_BUFFER_LEN	1600
+#define CARL9170_PGEN_DESC_NUM		4
+
+/* (TA, TID) sequence numbers kept for the rx duplicate detection */
+#define CARL9170_RX_DUP_CACHE_NUM	8
+
+#define CARL9170_RX_STA_NUM		8
+
+#define CARL9170_PS_STA_NUM		4
+#define CARL9170_PS_AC_MASK		(BIT(__AR9170_NUM_TXQ) - 1)
+
+/* rx frames waiting for the upload, before data frames get dropped */
+#define CARL9170_RX_CONGESTION_THRESHOLD	(AR9170_RX_BLOCK_NUMBER / 2)
+
+/* timer ticks with rx overruns (tx pressure) before blocks are lent (returned) */
+#define CARL9170_RX_BALANCE_LEND_TICKS		4
+#define CARL9170_RX_BALANCE_RETURN_TICKS	2
+#define CARL9170_RX_BALANCE_STEP		4
+#define CARL9170_RX_BALANCE_MAX			(AR9170_TX_BLOCK_NUMBER / 2)
+
+/* probe response template (superframe) for each vif */
+#define CARL9170_PROBE_RESP_BUFFER_LEN	512
+
+/* header templates (superdesc, hwdesc, 802.11 and LLC/SNAP header) for compact tx frames */
+#define CARL9170_TX_FLOW_NUM		16
+#define CARL9170_TX_FLOW_BUFFER_LEN	80
+
+/* A-MSDU stations, the largest frame (superframe) to merge and subframes per A-MSDU */
+#define CARL9170_AMSDU_STA_NUM		8
+#define CARL9170_TX_AMSDU_FRAME_LEN	256
+#define CARL9170_TX_AMSDU_MAX_FRAMES	8
+
+/* leaves room for the original length and rx status in the first block */
+#define CARL9170_RX_TRUNCATE_MAX	256
+
+/* first attempts per decision, and the failures to switch RTS/CTS on/off */
+#define CARL9170_PROT_WINDOW		16
+#define CARL9170_PROT_ON_THRESHOLD	6
+#define CARL9170_PROT_OFF_THRESHOLD	1
+
 #define CARL9170_GPIO_MASK		(AR9170_GPIO_PORT_WPS_BUTTON_PRESSED)
 
 #ifdef CONFIG_CARL9170FW_VIFS_NUM
@@ -58,6 +111,9 @@ static inline void __config_check(void)
 	BUILD_BUG_ON(!CARL9170_TX_STATUS_NUM);
 	BUILD_BUG_ON(CARL9170_INTF_NUM < 1);
 	BUILD_BUG_ON(CARL9170_INTF_NUM >= AR9170_MAX_VIRTUAL_MAC);
+	BUILD_BUG_ON(CARL9170_HANG_BUMP_USECS > CARL9170_HANG_DEBUG_USECS);
+	BUILD_BUG_ON(CARL9170_HANG_DEBUG_USECS > CARL9170_HANG_RESET_USECS);
+	BUILD_BUG_ON(CARL9170_HANG_RESET_USECS > CARL9170_HANG_MAX_USECS);
 }
 
 #endif /* __CARL9170FW_CONFIG_H */
@@ -52,9 +52,23 @@ struct dma_desc {
 
 #define AR9170_TERMINATOR_NUMBER_CAB	CARL9170_INTF_NUM
 
+#ifdef CONFIG_CARL9170FW_PATTERN_GENERATOR
+#define AR9170_TERMINATOR_NUMBER_PGEN	CARL9170_PGEN_DESC_NUM
+#else
+#define AR9170_TERMINATOR_NUMBER_PGEN	0
+#endif /* CONFIG_CARL9170FW_PATTERN_GENERATOR */
+
+#ifdef CONFIG_CARL9170FW_PS_POLL_OFFLOAD
+#define AR9170_TERMINATOR_NUMBER_PS	(CARL9170_PS_STA_NUM * __AR9170_NUM_TXQ)
+#else
+#define AR9170_TERMINATOR_NUMBER_PS	0
+#endif /* CONFIG_CARL9170FW_PS_POLL_OFFLOAD */
+
 #define AR9170_TERMINATOR_NUMBER (AR9170_TERMINATOR_NUMBER_B + \
 				  AR9170_TERMINATOR_NUMBER_INT + \
-				  AR9170_TERMINATOR_NUMBER_CAB)
+				  AR9170_TERMINATOR_NUMBER_CAB + \
+				  AR9170_TERMINATOR_NUMBER_PGEN + \
+				  AR9170_TERMINATOR_NUMBER_PS)
 
 #define AR9170_BLOCK_SIZE           (256 + 64)
 
@@ -82,6 +96,11 @@ struct carl9170_tx_null_superframe {
 
 #define CARL9170_BA_BUFFER_LEN	(__roundup(sizeof(struct carl9170_tx_ba_superframe), 16))
 #define CARL9170_RSP_BUFFER_LEN	AR9170_BLOCK_SIZE
+#define CARL9170_RX_STA_BUFFER_LEN	(__roundup(CARL9170_RX_STA_NUM * \
+					 (sizeof(struct carl9170_rx_sta_stats) + \
+					  sizeof(struct carl9170_rx_sta_rate_stats)), 64))
+#define CARL9170_RATE_TBL_BUFFER_LEN	(__roundup(CARL9170_RATE_TBL_NUM * \
+					 sizeof(struct carl9170_rate_tbl), 64))
 
 struct carl9170_sram_reserved {
 	union {
@@ -106,6 +125,42 @@ struct carl9170_sram_reserved {
 	union {
 		uint32_t buf[CARL9170_INTF_NUM][AR9170_MAC_BCN_LENGTH_MAX / sizeof(uint32_t)];
 	} bcn;
+
+#ifdef CONFIG_CARL9170FW_PATTERN_GENERATOR
+	union {
+		uint32_t buf[CARL9170_PGEN_BUFFER_LEN / sizeof(uint32_t)];
+		struct carl9170_tx_superframe super;
+	} pgen;
+#endif /* CONFIG_CARL9170FW_PATTERN_GENERATOR */
+
+#ifdef CONFIG_CARL9170FW_RX_STA_TABLE
+	union {
+		uint32_t buf[CARL9170_RX_STA_BUFFER_LEN / sizeof(uint32_t)];
+		struct {
+			struct carl9170_rx_sta_stats sta[CARL9170_RX_STA_NUM];
+			struct carl9170_rx_sta_rate_stats rates[CARL9170_RX_STA_NUM];
+		};
+	} rx_sta;
+#endif /* CONFIG_CARL9170FW_RX_STA_TABLE */
+
+#ifdef CONFIG_CARL9170FW_PROBE_RESP_OFFLOAD
+	union {
+		uint32_t buf[CARL9170_INTF_NUM][CARL9170_PROBE_RESP_BUFFER_LEN / sizeof(uint32_t)];
+	} probe;
+#endif /* CONFIG_CARL9170FW_PROBE_RESP_OFFLOAD */
+
+#ifdef CONFIG_CARL9170FW_TX_FLOW
+	union {
+		uint32_t buf[CARL9170_TX_FLOW_NUM][CARL9170_TX_FLOW_BUFFER_LEN / sizeof(uint32_t)];
+	} tx_flow;
+#endif /* CONFIG_CARL9170FW_TX_FLOW */
+
+#ifdef CONFIG_CARL9170FW_RATE_TABLE
+	union {
+		uint32_t buf[CARL9170_RATE_TBL_BUFFER_LEN / sizeof(uint32_t)];
+		struct carl9170_rate_tbl tbl[CARL9170_RATE_TBL_NUM];
+	} rate_tbl;
+#endif /* CONFIG_CARL9170FW_RATE_TABLE */
 };
 
 /*
@@ -119,6 +174,8 @@ struct carl9170_sram_reserved {
  *				|  - AMPDU TX retry
  *				|  - RX (from wifi)
  *				|  - CAB Queue
+ *				|  - Pattern generator (optional)
+ *				|  - PS-Poll/U-APSD hold queues (optional)
  *				|  - FW cmd & req descriptor
  *				|  - BlockAck descriptor
  *				| total: AR9170_TERMINATOR_NUMBER
@@ -138,6 +195,18 @@ struct carl9170_sram_reserved {
  *				+--
  *				| BEACON buffer (256 bytes)
  *				+--
+ *				| PGEN template (optional, 1600 bytes)
+ *				+--
+ *				| rx station table (optional, 640 bytes)
+ *				+--
+ *				| probe response templates (optional,
+ *				|  512 bytes for each vif)
+ *				+--
+ *				| tx header templates (optional,
+ *				|  80 bytes for each flow)
+ *				+--
+ *				| rate tables (optional, 320 bytes)
+ *				+--
  *				| unaccounted space / padding
  *				+--
  * 0x18000
@@ -338,6 +407,21 @@ static inline void __check_desc(void)
 	BUILD_BUG_ON(offsetof(struct carl9170_sram_reserved, cmd.buf) & (BLOCK_ALIGNMENT - 1));
 	BUILD_BUG_ON(offsetof(struct carl9170_sram_reserved, rsp.buf) & (BLOCK_ALIGNMENT - 1));
 	BUILD_BUG_ON(offsetof(struct carl9170_sram_reserved, bcn.buf) & (BLOCK_ALIGNMENT - 1));
+#ifdef CONFIG_CARL9170FW_PATTERN_GENERATOR
+	BUILD_BUG_ON(offsetof(struct carl9170_sram_reserved, pgen.buf) & (BLOCK_ALIGNMENT - 1));
+#endif /* CONFIG_CARL9170FW_PATTERN_GENERATOR */
+#ifdef CONFIG_CARL9170FW_RX_STA_TABLE
+	BUILD_BUG_ON(offsetof(struct carl9170_sram_reserved, rx_sta.buf) & (BLOCK_ALIGNMENT - 1));
+#endif /* CONFIG_CARL9170FW_RX_STA_TABLE */
+#ifdef CONFIG_CARL9170FW_PROBE_RESP_OFFLOAD
+	BUILD_BUG_ON(offsetof(struct carl9170_sram_reserved, probe.buf) & (BLOCK_ALIGNMENT - 1));
+#endif /* CONFIG_CARL9170FW_PROBE_RESP_OFFLOAD */
+#ifdef CONFIG_CARL9170FW_TX_FLOW
+	BUILD_BUG_ON(offsetof(struct carl9170_sram_reserved, tx_flow.buf) & (BLOCK_ALIGNMENT - 1));
+#endif /* CONFIG_CARL9170FW_TX_FLOW */
+#ifdef CONFIG_CARL9170FW_RATE_TABLE
+	BUILD_BUG_ON(offsetof(struct carl9170_sram_reserved, rate_tbl.buf) & (BLOCK_ALIGNMENT - 1));
+#endif /* CONFIG_CARL9170FW_RATE_TABLE */
 	BUILD_BUG_ON(sizeof(struct carl9170_tx_null_superframe) > CARL9170_MAX_CMD_LEN);
 }
 
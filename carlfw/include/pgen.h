@@ -0,0 +1,58 @@
+/*
+ * carl9170 firmware - used by the ar9170 wireless device
+ *
+ * Pattern generator definitions
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CARL9170FW_PGEN_H
+#define __CARL9170FW_PGEN_H
+
+#include "config.h"
+#include "compiler.h"
+#include "types.h"
+
+#include "fwcmd.h"
+#include "dma.h"
+
+#ifdef CONFIG_CARL9170FW_PATTERN_GENERATOR
+
+static inline bool pgen_is_frame(const struct carl9170_tx_superframe *super)
+{
+	return super == &dma_mem.reserved.pgen.super;
+}
+
+void pgen_cmd(const struct carl9170_pgen_cmd *cmd, struct carl9170_rsp *resp);
+void pgen_tx_done(struct dma_desc *desc, const bool success);
+void pgen_janitor(void);
+
+#else
+
+static inline bool pgen_is_frame(const struct carl9170_tx_superframe *super __unused)
+{
+	return false;
+}
+
+static inline void pgen_tx_done(struct dma_desc *desc __unused,
+				const bool success __unused)
+{
+}
+
+static inline void pgen_janitor(void)
+{
+}
+#endif /* CONFIG_CARL9170FW_PATTERN_GENERATOR */
+
+#endif /* __CARL9170FW_PGEN_H */
@@ -28,6 +28,7 @@
 #include "config.h"
 #include "carl9170.h"
 #include "io.h"
+#include "hostif.h"
 
 struct ieee80211_hdr;
 
@@ -267,10 +268,33 @@ static inline bool compare_ether_address(const void *_d0, const void *_d1)
 void wlan_tx(struct dma_desc *desc);
 void wlan_tx_fw(struct carl9170_tx_superdesc *super, fw_desc_callback_t cb);
 void wlan_timer(void);
+void wlan_check_hang(void);
+void wlan_tx_progress(const unsigned int qidx);
 void handle_wlan(void);
 
 void handle_wlan_rx(void);
 
+#ifdef CONFIG_CARL9170FW_RX_BALANCE
+void wlan_tx_reclaim(struct dma_desc *desc);
+void wlan_rx_reclaim(struct dma_desc *desc);
+#else
+static inline void wlan_tx_reclaim(struct dma_desc *desc)
+{
+	dma_reclaim(&fw.pta.down_queue, desc);
+	down_trigger();
+}
+
+static inline void wlan_rx_reclaim(struct dma_desc *desc)
+{
+	dma_reclaim(&fw.wlan.rx_queue, desc);
+	wlan_trigger(AR9170_DMA_TRIGGER_RXQ);
+}
+#endif /* CONFIG_CARL9170FW_RX_BALANCE */
+
+#ifdef CONFIG_CARL9170FW_RX_STA_TABLE
+void wlan_rx_sta_clear(const unsigned int slot);
+#endif /* CONFIG_CARL9170FW_RX_STA_TABLE */
+
 void wlan_send_buffered_tx_status(void);
 void wlan_send_buffered_cab(void);
 void wlan_send_buffered_ba(void);
@@ -278,11 +302,74 @@ void handle_wlan_tx_completion(void);
 void wlan_dma_bump(unsigned int qidx);
 
 void wlan_cab_flush_queue(const unsigned int vif);
+
+#ifdef CONFIG_CARL9170FW_PS_POLL_OFFLOAD
+bool wlan_ps_poll(const unsigned int sta);
+bool wlan_ps_trigger(const unsigned int sta, const unsigned int ac);
+void wlan_ps_set_sta(const unsigned int sta,
+		     const struct carl9170_ps_sta_cmd *cmd);
+#endif /* CONFIG_CARL9170FW_PS_POLL_OFFLOAD */
+
+#ifdef CONFIG_CARL9170FW_PROBE_RESP_OFFLOAD
+void wlan_set_probe_resp(const unsigned int vif, const unsigned int flags,
+			 struct carl9170_rsp *resp);
+bool wlan_send_probe_resp(const unsigned int vif, const uint8_t *da);
+
+static inline struct carl9170_tx_superframe *wlan_probe_resp_tmpl(const unsigned int vif)
+{
+	return (void *) dma_mem.reserved.probe.buf[vif];
+}
+#endif /* CONFIG_CARL9170FW_PROBE_RESP_OFFLOAD */
+
+#ifdef CONFIG_CARL9170FW_TX_FLOW
+void wlan_set_tx_flow(const unsigned int flow, const unsigned int flags,
+		      struct carl9170_rsp *resp);
+bool wlan_tx_expand(struct dma_desc *desc);
+
+static inline struct carl9170_tx_superframe *wlan_tx_flow_tmpl(const unsigned int flow)
+{
+	return (void *) dma_mem.reserved.tx_flow.buf[flow];
+}
+#else
+static inline bool wlan_tx_expand(struct dma_desc *desc __unused)
+{
+	return true;
+}
+#endif /* CONFIG_CARL9170FW_TX_FLOW */
+
+#ifdef CONFIG_CARL9170FW_RATE_TABLE
+void wlan_set_rate_tbl(const struct carl9170_rate_tbl_cmd *cmd);
+#endif /* CONFIG_CARL9170FW_RATE_TABLE */
+
+#ifdef CONFIG_CARL9170FW_TX_AMSDU
+void wlan_set_amsdu_sta(const unsigned int sta,
+			const struct carl9170_amsdu_sta_cmd *cmd);
+void wlan_tx_amsdu(struct dma_desc *desc);
+void wlan_tx_amsdu_flush(void);
+#else
+static inline void wlan_tx_amsdu(struct dma_desc *desc)
+{
+	wlan_tx(desc);
+}
+
+static inline void wlan_tx_amsdu_flush(void)
+{
+}
+#endif /* CONFIG_CARL9170FW_TX_AMSDU */
+
+#ifdef CONFIG_CARL9170FW_TXOP_BURST
+void wlan_set_txop(const struct carl9170_txop_cmd *cmd);
+#endif /* CONFIG_CARL9170FW_TXOP_BURST */
 void wlan_modify_beacon(const unsigned int vif,
 			const unsigned int bcn_addr,
 			const unsigned int bcn_len);
+void wlan_set_beacon_template(const unsigned int vif,
+			      const unsigned int bcn_addr,
+			      const unsigned int bcn_len);
+void wlan_send_beacon_template(void);
 
 void wlan_tx_complete(struct carl9170_tx_superframe *super, bool txs);
+
 void wlan_prepare_wol(void);
 
 static inline void __check_wlantx(void)
@@ -299,6 +386,21 @@ static inline void __check_wlantx(void)
 	BUILD_BUG_ON(sizeof(struct ar9170_rx_head) != AR9170_RX_HEAD_LEN);
 	BUILD_BUG_ON(sizeof(struct ar9170_rx_phystatus) != AR9170_RX_PHYSTATUS_LEN);
 	BUILD_BUG_ON(sizeof(struct ar9170_rx_macstatus) != AR9170_RX_MACSTATUS_LEN);
+	BUILD_BUG_ON(sizeof(struct carl9170_rx_decap_hdr) != CARL9170_RX_DECAP_HDR_LEN);
+	BUILD_BUG_ON(sizeof(struct carl9170_tx_compact_desc) != CARL9170_TX_COMPACT_DESC_LEN);
+	BUILD_BUG_ON(sizeof(struct carl9170_rate_tbl) !=
+		     CARL9170_RATE_TBL_CMD_SIZE - sizeof(__le32));
+	BUILD_BUG_ON(CARL9170_RATE_TBL_NUM > (CARL9170_TX_SUPER_RATE_TBL >>
+					      CARL9170_TX_SUPER_RATE_TBL_S));
+	BUILD_BUG_ON(offsetof(struct _carl9170_tx_superdesc, idx) + 1 !=
+		     offsetof(struct carl9170_tx_superdesc, ri));
+	BUILD_BUG_ON(offsetof(struct _carl9170_tx_superdesc, ri) !=
+		     offsetof(struct carl9170_tx_superdesc, ri));
+	BUILD_BUG_ON((CARL9170_TX_SUPER_PS_STA | CARL9170_TX_SUPER_RATE_TBL) != 0xff);
+	BUILD_BUG_ON(offsetof(struct carl9170_tx_compact_desc, marker) !=
+		     offsetof(struct carl9170_tx_superdesc, rix));
+	BUILD_BUG_ON(offsetof(struct carl9170_tx_compact_desc, cookie) !=
+		     offsetof(struct carl9170_tx_superdesc, cookie));
 }
 
 #endif /* __CARL9170FW_WLAN_H */
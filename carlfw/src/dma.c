@@ -90,6 +90,20 @@ void dma_init_descriptors(void)
 	for (j = 0; j < CARL9170_INTF_NUM; j++)
 		init_queue(&fw.wlan.cab_queue[j], &dma_mem.terminator[i++]);
 
+#ifdef CONFIG_CARL9170FW_PATTERN_GENERATOR
+	for (j = 0; j < CARL9170_PGEN_DESC_NUM; j++)
+		fw.pgen.free[fw.pgen.free_num++] = &dma_mem.terminator[i++];
+#endif /* CONFIG_CARL9170FW_PATTERN_GENERATOR */
+
+#ifdef CONFIG_CARL9170FW_PS_POLL_OFFLOAD
+	for (j = 0; j < CARL9170_PS_STA_NUM; j++) {
+		unsigned int ac;
+
+		for (ac = 0; ac < __AR9170_NUM_TXQ; ac++)
+			init_queue(&fw.wlan.ps_queue[j][ac], &dma_mem.terminator[i++]);
+	}
+#endif /* CONFIG_CARL9170FW_PS_POLL_OFFLOAD */
+
 	BUG_ON(AR9170_TERMINATOR_NUMBER != i);
 
 	DBG("Blocks:%d [tx:%d, rx:%d] Terminators:%d/%d\n",
@@ -55,6 +55,9 @@ const struct carl9170_firmware_descriptor __in_section(fwdsc) __visible carl9170
 					BIT(CARL9170FW_COMMAND_CAM) |
 #endif /* CONFIG_CARL9170FW_SECURITY_ENGINE */
 					BIT(CARL9170FW_WLANTX_CAB) |
+					BIT(CARL9170FW_BEACON_TEMPLATE) |
+					BIT(CARL9170FW_STATS) |
+					BIT(CARL9170FW_PARAMS) |
 #ifdef CONFIG_CARL9170FW_UNUSABLE
 					BIT(CARL9170FW_UNUSABLE) |
 #endif /* CONFIG_CARL9170FW_UNUSABLE */
@@ -64,6 +67,30 @@ const struct carl9170_firmware_descriptor __in_section(fwdsc) __visible carl9170
 #ifdef CONFIG_CARL9170FW_WOL
 					BIT(CARL9170FW_WOL) |
 #endif /* CONFIG_CARL9170FW_WOL */
+#ifdef CONFIG_CARL9170FW_PATTERN_GENERATOR
+					BIT(CARL9170FW_PATTERN_GENERATOR) |
+#endif /* CONFIG_CARL9170FW_PATTERN_GENERATOR */
+#ifdef CONFIG_CARL9170FW_RX_TSF
+					BIT(CARL9170FW_RX_TSF) |
+#endif /* CONFIG_CARL9170FW_RX_TSF */
+#ifdef CONFIG_CARL9170FW_PROBE_RESP_OFFLOAD
+					BIT(CARL9170FW_PROBE_RESP_OFFLOAD) |
+#endif /* CONFIG_CARL9170FW_PROBE_RESP_OFFLOAD */
+#ifdef CONFIG_CARL9170FW_RX_DECAP
+					BIT(CARL9170FW_RX_DECAP) |
+#endif /* CONFIG_CARL9170FW_RX_DECAP */
+#ifdef CONFIG_CARL9170FW_TX_FLOW
+					BIT(CARL9170FW_TX_FLOW) |
+#endif /* CONFIG_CARL9170FW_TX_FLOW */
+#ifdef CONFIG_CARL9170FW_RATE_TABLE
+					BIT(CARL9170FW_RATE_TABLE) |
+#endif /* CONFIG_CARL9170FW_RATE_TABLE */
+#ifdef CONFIG_CARL9170FW_TX_AMSDU
+					BIT(CARL9170FW_TX_AMSDU) |
+#endif /* CONFIG_CARL9170FW_TX_AMSDU */
+#ifdef CONFIG_CARL9170FW_TXOP_BURST
+					BIT(CARL9170FW_TXOP_BURST) |
+#endif /* CONFIG_CARL9170FW_TXOP_BURST */
 					(0)),
 
 	     .miniboot_size = cpu_to_le16(0),
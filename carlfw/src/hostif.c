@@ -31,12 +31,20 @@
 #include "rf.h"
 #include "timer.h"
 #include "wol.h"
+#include "pgen.h"
 
 static bool length_check(struct dma_desc *desc)
 {
 	volatile struct carl9170_tx_superframe *super = __get_super(desc);
+	unsigned int min_len = sizeof(struct carl9170_tx_superdesc);
 
-	if (unlikely(desc->totalLen < sizeof(struct carl9170_tx_superdesc)))
+#ifdef CONFIG_CARL9170FW_TX_FLOW
+	/* wlan_tx_expand() takes care of the rest */
+	if (super->s.rix == CARL9170_TX_COMPACT_MARKER)
+		min_len = sizeof(struct carl9170_tx_compact_desc);
+#endif /* CONFIG_CARL9170FW_TX_FLOW */
+
+	if (unlikely(desc->totalLen < min_len))
 		return false;
 
 	/*
@@ -52,6 +60,35 @@ static bool length_check(struct dma_desc *desc)
 	return true;
 }
 
+#ifdef CONFIG_CARL9170FW_USB_LOOPBACK
+static void handle_loopback(struct dma_desc *desc)
+{
+	struct carl9170_tx_superframe *super = __get_super(desc);
+
+	if (fw.usb.loopback & CARL9170_LOOPBACK_STAMP) {
+		super->s.rr[0].set = cpu_to_le32(get_clock_counter());
+		super->s.rr[1].set = cpu_to_le32(fw.ticks_per_usec);
+	}
+
+	fw.stats.loopback.frames++;
+	fw.stats.loopback.bytes += desc->totalLen;
+
+	dma_put(&fw.pta.up_queue, desc);
+	up_trigger();
+}
+
+/*
+ * The loopback frames still occupy blocks from the tx pool.
+ * They have to go back to the down_queue, or else the rx
+ * pool would grow at the expense of the tx pool.
+ */
+static inline bool is_loopback_desc(struct dma_desc *desc)
+{
+	return (uint8_t *) DESC_PAYLOAD(desc) <
+	       (uint8_t *) &dma_mem.data[AR9170_TX_BLOCK_NUMBER];
+}
+#endif /* CONFIG_CARL9170FW_USB_LOOPBACK */
+
 static void handle_download(void)
 {
 	struct dma_desc *desc;
@@ -64,7 +101,8 @@ static void handle_download(void)
 	 */
 
 	for_each_desc_not_bits(desc, &fw.pta.down_queue, AR9170_OWN_BITS_HW) {
-		if (unlikely((length_check(desc) == false))) {
+		if (unlikely((length_check(desc) == false) ||
+			     !wlan_tx_expand(desc))) {
 			/*
 			 * There is no easy way of telling what was lost.
 			 *
@@ -74,13 +112,19 @@ static void handle_download(void)
 			 */
 
 			wlan_tx_complete(__get_super(desc), false);
-			dma_reclaim(&fw.pta.down_queue, desc);
-			down_trigger();
+			wlan_tx_reclaim(desc);
+#ifdef CONFIG_CARL9170FW_USB_LOOPBACK
+		} else if (unlikely(fw.usb.loopback & CARL9170_LOOPBACK_ENABLE)) {
+			handle_loopback(desc);
+#endif /* CONFIG_CARL9170FW_USB_LOOPBACK */
 		} else {
-			wlan_tx(desc);
+			wlan_tx_amsdu(desc);
 		}
 	}
 
+	/* the burst is over */
+	wlan_tx_amsdu_flush();
+
 #ifdef CONFIG_CARL9170FW_DEBUG_LED_HEARTBEAT
 	xorl(AR9170_GPIO_REG_PORT_DATA, 2);
 #endif /* CONFIG_CARL9170FW_DEBUG_LED_HEARTBEAT */
@@ -99,9 +143,14 @@ static void handle_upload(void)
 		if (DESC_PAYLOAD(desc) == (void *) &dma_mem.reserved.rsp) {
 			fw.usb.int_desc = desc;
 			fw.usb.int_desc_available = 1;
+#ifdef CONFIG_CARL9170FW_USB_LOOPBACK
+		} else if (is_loopback_desc(desc)) {
+			dma_reclaim(&fw.pta.down_queue, desc);
+			down_trigger();
+#endif /* CONFIG_CARL9170FW_USB_LOOPBACK */
 		} else {
-			dma_reclaim(&fw.wlan.rx_queue, desc);
-			wlan_trigger(AR9170_DMA_TRIGGER_RXQ);
+			fw.wlan.rx_up_pending--;
+			wlan_rx_reclaim(desc);
 		}
 	}
 
@@ -168,6 +217,271 @@ void handle_host_interface(void)
 #undef HANDLER
 }
 
+static void handle_stats(const struct carl9170_stats_cmd *cmd,
+			 struct carl9170_rsp *resp)
+{
+	const unsigned int id = le32_to_cpu(cmd->id) & ~CARL9170_STATS_CLEAR;
+	const unsigned int index = le32_to_cpu(cmd->index);
+	void *stats;
+
+	/*
+	 * Unknown (or compiled-out) statistics blocks are
+	 * answered with an empty response.
+	 */
+	resp->hdr.len = 0;
+
+	switch (id) {
+	case CARL9170_STATS_CAB:
+		if (index >= CARL9170_INTF_NUM)
+			return;
+
+		stats = &fw.stats.cab[index];
+		resp->hdr.len = sizeof(struct carl9170_cab_stats);
+		break;
+
+	case CARL9170_STATS_HANG:
+		if (index >= __AR9170_NUM_TX_QUEUES)
+			return;
+
+		stats = &fw.stats.hang[index];
+		resp->hdr.len = sizeof(struct carl9170_hang_stats);
+		break;
+
+	case CARL9170_STATS_MCAST:
+		stats = &fw.stats.mcast;
+		resp->hdr.len = sizeof(struct carl9170_mcast_stats);
+		break;
+
+	case CARL9170_STATS_RX_CONGESTION:
+		stats = &fw.stats.rx_congestion;
+		resp->hdr.len = sizeof(struct carl9170_rx_congestion_stats);
+		break;
+
+#ifdef CONFIG_CARL9170FW_RX_DECAP
+	case CARL9170_STATS_RX_DECAP:
+		stats = &fw.stats.rx_decap;
+		resp->hdr.len = sizeof(struct carl9170_rx_decap_stats);
+		break;
+#endif /* CONFIG_CARL9170FW_RX_DECAP */
+
+#ifdef CONFIG_CARL9170FW_TX_FLOW
+	case CARL9170_STATS_TX_FLOW:
+		stats = &fw.stats.tx_flow;
+		resp->hdr.len = sizeof(struct carl9170_tx_flow_stats);
+		break;
+#endif /* CONFIG_CARL9170FW_TX_FLOW */
+
+#ifdef CONFIG_CARL9170FW_TX_AMSDU
+	case CARL9170_STATS_TX_AMSDU:
+		stats = &fw.stats.tx_amsdu;
+		resp->hdr.len = sizeof(struct carl9170_tx_amsdu_stats);
+		break;
+#endif /* CONFIG_CARL9170FW_TX_AMSDU */
+
+#ifdef CONFIG_CARL9170FW_TXOP_BURST
+	case CARL9170_STATS_TXOP:
+		stats = &fw.stats.txop;
+		resp->hdr.len = sizeof(struct carl9170_txop_stats);
+		break;
+#endif /* CONFIG_CARL9170FW_TXOP_BURST */
+
+#ifdef CONFIG_CARL9170FW_RX_STA_TABLE
+	case CARL9170_STATS_RX_STA:
+	case CARL9170_STATS_RX_STA_RATES:
+		if (index >= CARL9170_RX_STA_NUM)
+			return;
+
+		if (id == CARL9170_STATS_RX_STA) {
+			stats = &dma_mem.reserved.rx_sta.sta[index];
+			resp->hdr.len = sizeof(struct carl9170_rx_sta_stats);
+		} else {
+			stats = &dma_mem.reserved.rx_sta.rates[index];
+			resp->hdr.len = sizeof(struct carl9170_rx_sta_rate_stats);
+		}
+
+		/* a slot is only ever cleared as a whole */
+		memcpy(resp->data, stats, resp->hdr.len);
+		if (le32_to_cpu(cmd->id) & CARL9170_STATS_CLEAR)
+			wlan_rx_sta_clear(index);
+		return;
+#endif /* CONFIG_CARL9170FW_RX_STA_TABLE */
+
+#ifdef CONFIG_CARL9170FW_PS_POLL_OFFLOAD
+	case CARL9170_STATS_PS:
+		if (index >= CARL9170_PS_STA_NUM)
+			return;
+
+		stats = &fw.stats.ps[index];
+		resp->hdr.len = sizeof(struct carl9170_ps_stats);
+		break;
+#endif /* CONFIG_CARL9170FW_PS_POLL_OFFLOAD */
+
+#ifdef CONFIG_CARL9170FW_PROBE_RESP_OFFLOAD
+	case CARL9170_STATS_PROBE_RESP:
+		if (index >= CARL9170_INTF_NUM)
+			return;
+
+		stats = &fw.stats.probe_resp[index];
+		resp->hdr.len = sizeof(struct carl9170_probe_resp_stats);
+		break;
+#endif /* CONFIG_CARL9170FW_PROBE_RESP_OFFLOAD */
+
+#ifdef CONFIG_CARL9170FW_RX_BALANCE
+	case CARL9170_STATS_RX_BALANCE:
+		fw.stats.rx_balance.lent = fw.wlan.rx_lent;
+		fw.stats.rx_balance.tick = fw.ticks_per_usec;
+		stats = &fw.stats.rx_balance;
+		resp->hdr.len = sizeof(struct carl9170_rx_balance_stats);
+		break;
+#endif /* CONFIG_CARL9170FW_RX_BALANCE */
+
+	case CARL9170_STATS_RX_FILTER:
+		if (index >= CARL9170_RX_FILTER_CLASSES)
+			return;
+
+		stats = &fw.stats.rx_filter[index];
+		resp->hdr.len = sizeof(struct carl9170_rx_filter_stats);
+		break;
+
+#ifdef CONFIG_CARL9170FW_FW_MAC_RESET
+	case CARL9170_STATS_MAC_RESET:
+		stats = &fw.stats.mac_reset;
+		resp->hdr.len = sizeof(struct carl9170_mac_reset_stats);
+		break;
+#endif /* CONFIG_CARL9170FW_FW_MAC_RESET */
+
+#ifdef CONFIG_CARL9170FW_PATTERN_GENERATOR
+	case CARL9170_STATS_PGEN:
+		stats = &fw.stats.pgen;
+		resp->hdr.len = sizeof(struct carl9170_pgen_stats);
+		break;
+#endif /* CONFIG_CARL9170FW_PATTERN_GENERATOR */
+
+#ifdef CONFIG_CARL9170FW_RX_TEST
+	case CARL9170_STATS_RX_TEST:
+		fw.stats.rx_test.tick = fw.ticks_per_usec;
+		stats = &fw.stats.rx_test;
+		resp->hdr.len = sizeof(struct carl9170_rx_test_stats);
+		break;
+
+	case CARL9170_STATS_RX_RATES:
+		if (index >= __CARL9170_RX_RATE_NUM)
+			return;
+
+		stats = &fw.stats.rx_rates[index];
+		resp->hdr.len = sizeof(struct carl9170_rx_rate_stats);
+		break;
+#endif /* CONFIG_CARL9170FW_RX_TEST */
+
+#ifdef CONFIG_CARL9170FW_USB_LOOPBACK
+	case CARL9170_STATS_LOOPBACK:
+		stats = &fw.stats.loopback;
+		resp->hdr.len = sizeof(struct carl9170_loopback_stats);
+		break;
+#endif /* CONFIG_CARL9170FW_USB_LOOPBACK */
+
+#ifdef CONFIG_CARL9170FW_ADAPTIVE_PROTECTION
+	case CARL9170_STATS_PROT:
+		if (index >= __AR9170_NUM_TX_QUEUES)
+			return;
+
+		stats = &fw.stats.prot[index];
+		resp->hdr.len = sizeof(struct carl9170_prot_stats);
+		break;
+#endif /* CONFIG_CARL9170FW_ADAPTIVE_PROTECTION */
+
+	default:
+		return;
+	}
+
+	memcpy(resp->data, stats, resp->hdr.len);
+	if (le32_to_cpu(cmd->id) & CARL9170_STATS_CLEAR)
+		memset(stats, 0, resp->hdr.len);
+}
+
+static void handle_param(const struct carl9170_cmd *cmd,
+			 struct carl9170_rsp *resp)
+{
+	const unsigned int value = le32_to_cpu(cmd->param.value);
+	unsigned int *param, min, max;
+
+	switch (le32_to_cpu(cmd->param.id)) {
+	/* keep the escalation order: bump <= debug <= reset */
+	case CARL9170_PARAM_HANG_BUMP_USECS:
+		param = &fw.wlan.hang_bump_usecs;
+		min = CARL9170_HANG_CHECK_USECS;
+		max = fw.wlan.hang_debug_usecs;
+		break;
+	case CARL9170_PARAM_HANG_DEBUG_USECS:
+		param = &fw.wlan.hang_debug_usecs;
+		min = fw.wlan.hang_bump_usecs;
+		max = fw.wlan.hang_reset_usecs;
+		break;
+	case CARL9170_PARAM_HANG_RESET_USECS:
+		param = &fw.wlan.hang_reset_usecs;
+		min = fw.wlan.hang_debug_usecs;
+		max = CARL9170_HANG_MAX_USECS;
+		break;
+
+#ifdef CONFIG_CARL9170FW_RX_TSF
+	case CARL9170_PARAM_RX_TSF:
+		param = &fw.wlan.rx_tsf;
+		min = CARL9170_RX_TSF_OFF;
+		max = CARL9170_RX_TSF_CLOCK;
+		break;
+#endif /* CONFIG_CARL9170FW_RX_TSF */
+
+#ifdef CONFIG_CARL9170FW_RX_DECAP
+	case CARL9170_PARAM_RX_DECAP:
+		param = &fw.wlan.rx_decap;
+		min = 0;
+		max = 1;
+		break;
+#endif /* CONFIG_CARL9170FW_RX_DECAP */
+
+#ifdef CONFIG_CARL9170FW_RX_TRUNCATE
+	case CARL9170_PARAM_RX_TRUNCATE:
+		param = &fw.wlan.rx_truncate;
+		min = 0;
+		max = CARL9170_RX_TRUNCATE_MAX;
+		break;
+#endif /* CONFIG_CARL9170FW_RX_TRUNCATE */
+
+#ifdef CONFIG_CARL9170FW_RX_TEST
+	case CARL9170_PARAM_RX_TEST:
+		param = &fw.wlan.rx_test;
+		min = 0;
+		max = 1;
+		break;
+#endif /* CONFIG_CARL9170FW_RX_TEST */
+
+#ifdef CONFIG_CARL9170FW_USB_LOOPBACK
+	case CARL9170_PARAM_USB_LOOPBACK:
+		param = &fw.usb.loopback;
+		min = 0;
+		max = CARL9170_LOOPBACK_ENABLE | CARL9170_LOOPBACK_STAMP;
+		break;
+#endif /* CONFIG_CARL9170FW_USB_LOOPBACK */
+
+	default:
+		resp->hdr.len = 0;
+		return;
+	}
+
+	if (cmd->hdr.len >= sizeof(struct carl9170_param_cmd)) {
+		if (value < min || value > max) {
+			resp->hdr.len = 0;
+			return;
+		}
+
+		*param = value;
+	}
+
+	resp->hdr.len = sizeof(struct carl9170_param_cmd);
+	resp->param.id = cmd->param.id;
+	resp->param.value = cpu_to_le32(*param);
+}
+
 void handle_cmd(struct carl9170_rsp *resp)
 {
 	struct carl9170_cmd *cmd = &dma_mem.reserved.cmd.cmd;
@@ -203,6 +517,7 @@ void handle_cmd(struct carl9170_rsp *resp)
 		 * resp->hdr.len = 0;
 		 */
 		fw.wlan.mac_reset = CARL9170_MAC_RESET_FORCE;
+		fw.wlan.mac_reset_cause = CARL9170_MAC_RESET_CAUSE_HOST;
 #endif /* CONFIG_CARL9170FW_FW_MAC_RESET */
 		break;
 
@@ -244,18 +559,65 @@ void handle_cmd(struct carl9170_rsp *resp)
 			setb(cmd->wregb.addr + i, cmd->wregb.val[i]);
 		break;
 
+	case CARL9170_CMD_STATS:
+		handle_stats(&cmd->stats, resp);
+		break;
+
+	case CARL9170_CMD_PARAM:
+		handle_param(cmd, resp);
+		break;
+
+	case CARL9170_CMD_BCN_FILTER:
+		resp->hdr.len = 0;
+		fw.wlan.bcn_filter_flags = le32_to_cpu(cmd->bcn_filter.flags);
+		fw.wlan.bcn_filter_aid = le32_to_cpu(cmd->bcn_filter.aid);
+		fw.wlan.bcn_filter_keepalive = le32_to_cpu(cmd->bcn_filter.keepalive);
+
+		/* let the next beacon through */
+		fw.wlan.bcn_filter_hash = 0;
+		break;
+
+	case CARL9170_CMD_MCAST_FILTER:
+		resp->hdr.len = 0;
+		i = min(le32_to_cpu(cmd->mcast_filter.count),
+			(unsigned int) CARL9170_MCAST_FILTER_NUM);
+
+		/* a short command keeps the old table */
+		if (cmd->hdr.len < sizeof(cmd->mcast_filter.count) +
+				   i * sizeof(cmd->mcast_filter.addr[0]))
+			break;
+
+		fw.wlan.mcast_num = i;
+		for (i = 0; i < fw.wlan.mcast_num; i++)
+			memcpy(fw.wlan.mcast_addr[i], cmd->mcast_filter.addr[i], 6);
+		break;
+
 	case CARL9170_CMD_BCN_CTRL:
 		resp->hdr.len = 0;
 
-		if (cmd->bcn_ctrl.mode & CARL9170_BCN_CTRL_CAB_TRIGGER) {
+		if (unlikely(cmd->bcn_ctrl.vif_id >= CARL9170_INTF_NUM))
+			break;
+
+		if (cmd->bcn_ctrl.mode & CARL9170_BCN_CTRL_TEMPLATE) {
+			/*
+			 * From now on, the firmware takes care of the DTIM
+			 * count, sequence number and multicast TIM bit.
+			 * The beacon is armed on every PRETBTT event.
+			 */
+			wlan_set_beacon_template(cmd->bcn_ctrl.vif_id,
+				cmd->bcn_ctrl.bcn_addr, cmd->bcn_ctrl.bcn_len);
+		} else if (cmd->bcn_ctrl.mode & CARL9170_BCN_CTRL_CAB_TRIGGER) {
 			wlan_modify_beacon(cmd->bcn_ctrl.vif_id,
 				cmd->bcn_ctrl.bcn_addr, cmd->bcn_ctrl.bcn_len);
 			set(AR9170_MAC_REG_BCN_ADDR, cmd->bcn_ctrl.bcn_addr);
 			set(AR9170_MAC_REG_BCN_LENGTH, cmd->bcn_ctrl.bcn_len);
 			set(AR9170_MAC_REG_BCN_CTRL, AR9170_BCN_CTRL_READY);
 		} else {
+			/* stop beaconing, the template (if any) is retired. */
+			fw.wlan.bcn_tmpl_len[cmd->bcn_ctrl.vif_id] = 0;
 			wlan_cab_flush_queue(cmd->bcn_ctrl.vif_id);
 			fw.wlan.cab_flush_trigger[cmd->bcn_ctrl.vif_id] = CARL9170_CAB_TRIGGER_EMPTY;
+			fw.wlan.cab_armed &= ~BIT(cmd->bcn_ctrl.vif_id);
 		}
 		break;
 
@@ -291,6 +653,74 @@ void handle_cmd(struct carl9170_rsp *resp)
 		break;
 #endif /* CONFIG_CARL9170FW_RADIO_FUNCTIONS */
 
+#ifdef CONFIG_CARL9170FW_PS_POLL_OFFLOAD
+	case CARL9170_CMD_PS_STA:
+		resp->hdr.len = 0;
+
+		if (le32_to_cpu(cmd->ps_sta.sta) < CARL9170_PS_STA_NUM) {
+			wlan_ps_set_sta(le32_to_cpu(cmd->ps_sta.sta),
+					&cmd->ps_sta);
+		}
+		break;
+#endif /* CONFIG_CARL9170FW_PS_POLL_OFFLOAD */
+
+#ifdef CONFIG_CARL9170FW_PROBE_RESP_OFFLOAD
+	case CARL9170_CMD_PROBE_RESP:
+		if (unlikely(le32_to_cpu(cmd->probe_resp.vif_id) >= CARL9170_INTF_NUM)) {
+			resp->hdr.len = 0;
+			break;
+		}
+
+		wlan_set_probe_resp(le32_to_cpu(cmd->probe_resp.vif_id),
+				    le32_to_cpu(cmd->probe_resp.flags), resp);
+		break;
+#endif /* CONFIG_CARL9170FW_PROBE_RESP_OFFLOAD */
+
+#ifdef CONFIG_CARL9170FW_TX_FLOW
+	case CARL9170_CMD_TX_FLOW:
+		if (unlikely(le32_to_cpu(cmd->tx_flow.flow) >= CARL9170_TX_FLOW_NUM)) {
+			resp->hdr.len = 0;
+			break;
+		}
+
+		wlan_set_tx_flow(le32_to_cpu(cmd->tx_flow.flow),
+				 le32_to_cpu(cmd->tx_flow.flags), resp);
+		break;
+#endif /* CONFIG_CARL9170FW_TX_FLOW */
+
+#ifdef CONFIG_CARL9170FW_RATE_TABLE
+	case CARL9170_CMD_RATE_TBL:
+		resp->hdr.len = 0;
+
+		if (le32_to_cpu(cmd->rate_tbl.idx) - 1 < CARL9170_RATE_TBL_NUM)
+			wlan_set_rate_tbl(&cmd->rate_tbl);
+		break;
+#endif /* CONFIG_CARL9170FW_RATE_TABLE */
+
+#ifdef CONFIG_CARL9170FW_TX_AMSDU
+	case CARL9170_CMD_AMSDU_STA:
+		resp->hdr.len = 0;
+
+		if (le32_to_cpu(cmd->amsdu_sta.sta) < CARL9170_AMSDU_STA_NUM) {
+			wlan_set_amsdu_sta(le32_to_cpu(cmd->amsdu_sta.sta),
+					   &cmd->amsdu_sta);
+		}
+		break;
+#endif /* CONFIG_CARL9170FW_TX_AMSDU */
+
+#ifdef CONFIG_CARL9170FW_TXOP_BURST
+	case CARL9170_CMD_TXOP:
+		resp->hdr.len = 0;
+		wlan_set_txop(&cmd->txop);
+		break;
+#endif /* CONFIG_CARL9170FW_TXOP_BURST */
+
+#ifdef CONFIG_CARL9170FW_PATTERN_GENERATOR
+	case CARL9170_CMD_PGEN:
+		pgen_cmd(&cmd->pgen, resp);
+		break;
+#endif /* CONFIG_CARL9170FW_PATTERN_GENERATOR */
+
 	default:
 		BUG("Unknown command %x\n", cmd->hdr.cmd);
 		break;
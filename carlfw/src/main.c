@@ -58,6 +58,11 @@ static void init(void)
 
 	orl(AR9170_MAC_REG_AFTER_PNP, 1);
 
+	/* TX hang detection thresholds, the application can change them */
+	fw.wlan.hang_bump_usecs = CARL9170_HANG_BUMP_USECS;
+	fw.wlan.hang_debug_usecs = CARL9170_HANG_DEBUG_USECS;
+	fw.wlan.hang_reset_usecs = CARL9170_HANG_RESET_USECS;
+
 	/* Init watch dog control flag */
 	fw.watchdog_enable = 1;
 
@@ -99,6 +104,19 @@ static void tally_update(void)
 			fw.tally.tx_time += delta;
 		if (boff & AR9170_MAC_BACKOFF_CCA)
 			fw.tally.cca += delta;
+
+#ifdef CONFIG_CARL9170FW_PATTERN_GENERATOR
+		if (fw.pgen.running) {
+			fw.stats.pgen.elapsed += delta;
+			if (boff & AR9170_MAC_BACKOFF_TX_PE)
+				fw.stats.pgen.tx_time += delta;
+		}
+#endif /* CONFIG_CARL9170FW_PATTERN_GENERATOR */
+
+#ifdef CONFIG_CARL9170FW_RX_TEST
+		if (fw.wlan.rx_test)
+			fw.stats.rx_test.elapsed += delta;
+#endif /* CONFIG_CARL9170FW_RX_TEST */
 	}
 #endif /* CONFIG_CARL9170FW_RADIO_FUNCTIONS */
 	fw.tally_clock = time;
@@ -0,0 +1,141 @@
+/*
+ * carl9170 firmware - used by the ar9170 wireless device
+ *
+ * Pattern generator
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "carl9170.h"
+#include "timer.h"
+#include "wl.h"
+#include "printf.h"
+#include "pgen.h"
+#include "linux/ieee80211.h"
+
+#ifdef CONFIG_CARL9170FW_PATTERN_GENERATOR
+
+/*
+ * The application uploads a complete superframe (just like the ones
+ * it sends through the USB bulk endpoint) into dma_mem.reserved.pgen.
+ * All generator descriptors point to this single template. The
+ * hardware only reads it, so the frames can share the buffer.
+ */
+
+static bool pgen_prepare(const struct carl9170_pgen_cmd *cmd)
+{
+	struct carl9170_tx_superframe *super = &dma_mem.reserved.pgen.super;
+	const unsigned int size = le32_to_cpu(cmd->size);
+
+	if (size) {
+		if (size > sizeof(dma_mem.reserved.pgen) -
+			   sizeof(struct carl9170_tx_superdesc) -
+			   sizeof(struct ar9170_tx_hwdesc))
+			return false;
+
+		super->s.len = cpu_to_le16(sizeof(struct carl9170_tx_superdesc) +
+			sizeof(struct ar9170_tx_hwdesc) + size);
+		super->f.hdr.length = cpu_to_le16(size + FCS_LEN);
+	}
+
+	if (!ar9170_tx_length_check(le16_to_cpu(super->s.len)) ||
+	    le16_to_cpu(super->s.len) > sizeof(dma_mem.reserved.pgen))
+		return false;
+
+	if (cmd->phy)
+		super->f.hdr.phy.set = cmd->phy;
+
+	/* there's no BlockAck session to aggregate frames into */
+	super->f.hdr.mac.ampdu = 0;
+	return true;
+}
+
+void pgen_cmd(const struct carl9170_pgen_cmd *cmd, struct carl9170_rsp *resp)
+{
+	fw.pgen.running = 0;
+
+	/*
+	 * Frames of a previous run have to drain first.
+	 * pgen_janitor will take care of the remaining ones.
+	 */
+	if ((le32_to_cpu(cmd->flags) & CARL9170_PGEN_START) &&
+	    le32_to_cpu(cmd->interval) < CARL9170_CLOCK_WRAP_USECS &&
+	    fw.pgen.free_num == CARL9170_PGEN_DESC_NUM &&
+	    pgen_prepare(cmd)) {
+		fw.pgen.remaining = le32_to_cpu(cmd->count);
+		if (!fw.pgen.remaining)
+			fw.pgen.remaining = ~0;
+
+		fw.pgen.interval = le32_to_cpu(cmd->interval);
+		fw.pgen.last = get_clock_counter();
+
+		memset(&fw.stats.pgen, 0, sizeof(fw.stats.pgen));
+		fw.stats.pgen.tick = fw.ticks_per_usec;
+		fw.pgen.running = 1;
+	}
+
+	resp->hdr.len = sizeof(struct carl9170_pgen_rsp);
+	resp->pgen.addr = cpu_to_le32(&dma_mem.reserved.pgen);
+	resp->pgen.len = cpu_to_le32(sizeof(dma_mem.reserved.pgen));
+	resp->pgen.running = cpu_to_le32(fw.pgen.running);
+}
+
+void pgen_tx_done(struct dma_desc *desc, const bool success)
+{
+	if (success)
+		fw.stats.pgen.completed++;
+	else
+		fw.stats.pgen.failed++;
+
+	fw.pgen.free[fw.pgen.free_num++] = desc;
+}
+
+void pgen_janitor(void)
+{
+	struct carl9170_tx_superframe *super = &dma_mem.reserved.pgen.super;
+	struct dma_desc *desc;
+
+	if (likely(!fw.pgen.running))
+		return;
+
+	while (fw.pgen.free_num && fw.pgen.remaining) {
+		if (fw.pgen.interval) {
+			if ((get_clock_counter() - fw.pgen.last) /
+			    fw.ticks_per_usec < fw.pgen.interval)
+				return;
+
+			fw.pgen.last = get_clock_counter();
+		}
+
+		desc = fw.pgen.free[--fw.pgen.free_num];
+		desc->ctrl = AR9170_CTRL_FS_BIT | AR9170_CTRL_LS_BIT;
+		desc->status = AR9170_OWN_BITS_SW;
+		desc->totalLen = desc->dataSize = le16_to_cpu(super->s.len) -
+			sizeof(struct carl9170_tx_superdesc);
+		desc->dataAddr = &super->f;
+		desc->nextAddr = desc->lastAddr = desc;
+
+		dma_put(&fw.wlan.tx_queue[super->s.queue], desc);
+		wlan_trigger(BIT(super->s.queue));
+
+		fw.pgen.remaining--;
+		fw.stats.pgen.queued++;
+	}
+
+	/* all requested frames are out */
+	if (!fw.pgen.remaining && fw.pgen.free_num == CARL9170_PGEN_DESC_NUM)
+		fw.pgen.running = 0;
+}
+
+#endif /* CONFIG_CARL9170FW_PATTERN_GENERATOR */
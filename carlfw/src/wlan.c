@@ -31,6 +31,8 @@
 #include "rf.h"
 #include "linux/ieee80211.h"
 #include "wol.h"
+#include "pgen.h"
+#include "usb.h"
 
 #ifdef CONFIG_CARL9170FW_DEBUG
 static void wlan_dump_queue(unsigned int qidx)
@@ -70,6 +72,60 @@ static void wlan_dump_queue(unsigned int qidx)
 }
 #endif /* CONFIG_CARL9170FW_DEBUG */
 
+#ifdef CONFIG_CARL9170FW_RX_BALANCE
+static void wlan_rx_balance(const bool overrun)
+{
+	struct carl9170_rx_balance_stats *stats = &fw.stats.rx_balance;
+	bool tx_pressure = false;
+	unsigned int i;
+
+	for (i = 0; i < __AR9170_NUM_TX_QUEUES; i++) {
+		if (!queue_empty(&fw.wlan.tx_queue[i]))
+			tx_pressure = true;
+	}
+
+	/* hysteresis: both conditions have to persist for a while */
+	if (overrun && !tx_pressure)
+		fw.wlan.rx_overrun_ticks++;
+	else
+		fw.wlan.rx_overrun_ticks = 0;
+
+	if (tx_pressure)
+		fw.wlan.tx_pressure_ticks++;
+	else
+		fw.wlan.tx_pressure_ticks = 0;
+
+	/*
+	 * The blocks are taken from the next tx blocks that are
+	 * recycled. The down DMA never sees them disappear.
+	 */
+	if (fw.wlan.rx_overrun_ticks >= CARL9170_RX_BALANCE_LEND_TICKS &&
+	    fw.wlan.rx_lent < CARL9170_RX_BALANCE_MAX &&
+	    !fw.wlan.rx_lend && !fw.wlan.rx_return) {
+		fw.wlan.rx_overrun_ticks = 0;
+		fw.wlan.rx_lend = min_t(unsigned int, CARL9170_RX_BALANCE_STEP,
+			CARL9170_RX_BALANCE_MAX - fw.wlan.rx_lent);
+		stats->lend_events++;
+		stats->last_event = get_clock_counter();
+	}
+
+	/* the blocks go back, once the hardware is done with them */
+	if (fw.wlan.tx_pressure_ticks >= CARL9170_RX_BALANCE_RETURN_TICKS) {
+		fw.wlan.rx_lend = 0;
+
+		if (fw.wlan.rx_lent != fw.wlan.rx_return) {
+			fw.wlan.rx_return = fw.wlan.rx_lent;
+			stats->return_events++;
+			stats->last_event = get_clock_counter();
+		}
+	}
+}
+#else
+static inline void wlan_rx_balance(const bool __unused overrun)
+{
+}
+#endif /* CONFIG_CARL9170FW_RX_BALANCE */
+
 static void wlan_check_rx_overrun(void)
 {
 	uint32_t overruns, total;
@@ -80,10 +136,13 @@ static void wlan_check_rx_overrun(void)
 		if (overruns == total) {
 			DBG("RX Overrun");
 			fw.wlan.mac_reset++;
+			fw.wlan.mac_reset_cause = CARL9170_MAC_RESET_CAUSE_RX_OVERRUN;
 		}
 
 		wlan_trigger(AR9170_DMA_TRIGGER_RXQ);
 	}
+
+	wlan_rx_balance(!!overruns);
 }
 
 static void handle_beacon_config(void)
@@ -97,7 +156,9 @@ static void handle_beacon_config(void)
 
 static void handle_pretbtt(void)
 {
-	fw.wlan.cab_flush_time = get_clock_counter();
+	fw.wlan.pretbtt_time = get_clock_counter();
+
+	wlan_send_beacon_template();
 
 #ifdef CONFIG_CARL9170FW_RADIO_FUNCTIONS
 	rf_psm();
@@ -112,7 +173,7 @@ static void handle_atim(void)
 	send_cmd_to_host(0, CARL9170_RSP_ATIM, 0x00, NULL);
 }
 
-#ifdef CONFIG_CARL9170FW_DEBUG
+#if (defined CONFIG_CARL9170FW_DEBUG) || (defined CONFIG_CARL9170FW_TXOP_BURST)
 static void handle_qos(void)
 {
 	/*
@@ -120,8 +181,13 @@ static void handle_qos(void)
 	 * Is it only an indicator for TXOP & Burst, or
 	 * should we do something here?
 	 */
+#ifdef CONFIG_CARL9170FW_TXOP_BURST
+	fw.stats.txop.qos_int++;
+#endif /* CONFIG_CARL9170FW_TXOP_BURST */
 }
+#endif /* CONFIG_CARL9170FW_DEBUG || CONFIG_CARL9170FW_TXOP_BURST */
 
+#ifdef CONFIG_CARL9170FW_DEBUG
 static void handle_radar(void)
 {
 	send_cmd_to_host(0, CARL9170_RSP_RADAR, 0x00, NULL);
@@ -130,6 +196,9 @@ static void handle_radar(void)
 
 static void wlan_janitor(void)
 {
+	/* TX Queue Hang check */
+	wlan_check_hang();
+
 	wlan_send_buffered_cab();
 
 	wlan_send_buffered_tx_status();
@@ -137,6 +206,8 @@ static void wlan_janitor(void)
 	wlan_send_buffered_ba();
 
 	wol_janitor();
+
+	pgen_janitor();
 }
 
 void handle_wlan(void)
@@ -166,9 +237,11 @@ void handle_wlan(void)
 	HANDLER(intr, (AR9170_MAC_INT_TXC | AR9170_MAC_INT_RETRY_FAIL),
 		handle_wlan_tx_completion);
 
-#ifdef CONFIG_CARL9170FW_DEBUG
+#if (defined CONFIG_CARL9170FW_DEBUG) || (defined CONFIG_CARL9170FW_TXOP_BURST)
 	HANDLER(intr, AR9170_MAC_INT_QOS, handle_qos);
+#endif /* CONFIG_CARL9170FW_DEBUG || CONFIG_CARL9170FW_TXOP_BURST */
 
+#ifdef CONFIG_CARL9170FW_DEBUG
 	HANDLER(intr, AR9170_MAC_INT_RADAR, handle_radar);
 #endif /* CONFIG_CARL9170FW_DEBUG */
 
@@ -182,74 +255,6 @@ void handle_wlan(void)
 #undef HANDLER
 }
 
-enum {
-	CARL9170FW_TX_MAC_BUMP = 4,
-	CARL9170FW_TX_MAC_DEBUG = 6,
-	CARL9170FW_TX_MAC_RESET = 7,
-};
-
-static void wlan_check_hang(void)
-{
-	struct dma_desc *desc;
-	int i;
-
-	for (i = AR9170_TXQ_SPECIAL; i >= AR9170_TXQ0; i--) {
-		if (queue_empty(&fw.wlan.tx_queue[i])) {
-			/* Nothing to do here... move along */
-			continue;
-		}
-
-		/* fetch the current DMA queue position */
-		desc = (struct dma_desc *)get_wlan_txq_addr(i);
-
-		/* Stuck frame detection */
-		if (unlikely(DESC_PAYLOAD(desc) == fw.wlan.last_super[i])) {
-			fw.wlan.last_super_num[i]++;
-
-			if (unlikely(fw.wlan.last_super_num[i] >= CARL9170FW_TX_MAC_RESET)) {
-				/*
-				 * schedule MAC reset (aka OFF/ON => dead)
-				 *
-				 * This will almost certainly kill
-				 * the device for good, but it's the
-				 * recommended thing to do...
-				 */
-
-				fw.wlan.mac_reset++;
-			}
-
-#ifdef CONFIG_CARL9170FW_DEBUG
-			if (unlikely(fw.wlan.last_super_num[i] >= CARL9170FW_TX_MAC_DEBUG)) {
-				/*
-				 * Sigh, the queue is almost certainly
-				 * dead. Dump the queue content to the
-				 * user, maybe we find out why it got
-				 * so stuck.
-				 */
-
-				wlan_dump_queue(i);
-			}
-#endif /* CONFIG_CARL9170FW_DEBUG */
-
-#ifdef CONFIG_CARL9170FW_DMA_QUEUE_BUMP
-			if (unlikely(fw.wlan.last_super_num[i] >= CARL9170FW_TX_MAC_BUMP)) {
-				/*
-				 * Hrrm, bump the queue a bit.
-				 * maybe this will get it going again.
-				 */
-
-				wlan_dma_bump(i);
-				wlan_trigger(BIT(i));
-			}
-#endif /* CONFIG_CARL9170FW_DMA_QUEUE_BUMP */
-		} else {
-			/* Nothing stuck */
-			fw.wlan.last_super[i] = DESC_PAYLOAD(desc);
-			fw.wlan.last_super_num[i] = 0;
-		}
-	}
-}
-
 #ifdef CONFIG_CARL9170FW_FW_MAC_RESET
 /*
  * NB: Resetting the MAC is a two-edged sword.
@@ -257,18 +262,74 @@ static void wlan_check_hang(void)
  * But there is a chance that this will make it
  * even worse and the radio dies silently.
  */
+/*
+ * MAC configuration which has to survive the reset.
+ * Counters, status and DMA registers are left out on purpose.
+ *
+ * PHY registers are not part of the table. The only PHY state
+ * that is restored is the rx chain switch: it is read from
+ * AR9170_PHY_REG_SWITCH_CHAIN_0 and written back through the
+ * write-only AR9170_PHY_REG_SWITCH_CHAIN_2.
+ */
+static const uint32_t wlan_mac_reset_regs[] = {
+	/* aggregation parameters */
+	AR9170_MAC_REG_AMPDU_FACTOR,
+	AR9170_MAC_REG_AMPDU_DENSITY,
+	AR9170_MAC_REG_AMPDU_RX_THRESH,
+
+	/* addresses and filters */
+	AR9170_MAC_REG_MAC_ADDR_L,
+	AR9170_MAC_REG_MAC_ADDR_H,
+	AR9170_MAC_REG_BSSID_L,
+	AR9170_MAC_REG_BSSID_H,
+	AR9170_MAC_REG_GROUP_HASH_TBL_L,
+	AR9170_MAC_REG_GROUP_HASH_TBL_H,
+	AR9170_MAC_REG_FRAMETYPE_FILTER,
+	AR9170_MAC_REG_SNIFFER,
+	AR9170_MAC_REG_RX_CONTROL,
+
+	/* beacon */
+	AR9170_MAC_REG_BCN_ADDR,
+	AR9170_MAC_REG_BCN_LENGTH,
+	AR9170_MAC_REG_BCN_PLCP,
+	AR9170_MAC_REG_BCN_HT1,
+	AR9170_MAC_REG_BCN_HT2,
+
+	/* security engine */
+	AR9170_MAC_REG_ENCRYPTION,
+	AR9170_MAC_REG_CAM_MODE,
+	AR9170_MAC_REG_CAM_ROLL_CALL_TBL_L,
+	AR9170_MAC_REG_CAM_ROLL_CALL_TBL_H,
+
+	/* rates, power and timing */
+	AR9170_MAC_REG_BASIC_RATE,
+	AR9170_MAC_REG_MANDATORY_RATE,
+	AR9170_MAC_REG_RTS_CTS_RATE,
+	AR9170_MAC_REG_ACK_TPC,
+	AR9170_MAC_REG_RTS_CTS_TPC,
+	AR9170_MAC_REG_BACKOFF_PROTECT,
+	AR9170_MAC_REG_SLOT_TIME,
+	AR9170_MAC_REG_EIFS_AND_SIFS,
+	AR9170_MAC_REG_RETRY_MAX,
+
+	/* EDCA */
+	AR9170_MAC_REG_AC0_CW,
+	AR9170_MAC_REG_AC1_CW,
+	AR9170_MAC_REG_AC2_CW,
+	AR9170_MAC_REG_AC3_CW,
+	AR9170_MAC_REG_AC4_CW,
+	AR9170_MAC_REG_AC2_AC1_AC0_AIFS,
+	AR9170_MAC_REG_AC4_AC3_AC2_AIFS,
+	AR9170_MAC_REG_AC1_AC0_TXOP,
+	AR9170_MAC_REG_AC3_AC2_TXOP,
+};
+
 static void wlan_mac_reset(void)
 {
-	uint32_t val;
-	uint32_t agg_wait_counter;
-	uint32_t agg_density;
-	uint32_t bcn_start_addr;
-	uint32_t rctl, rcth;
-	uint32_t cam_mode;
-	uint32_t ack_power;
-	uint32_t rts_cts_tpc;
-	uint32_t rts_cts_rate;
-	int i;
+	/* too big for the stack */
+	static uint32_t regs[ARRAY_SIZE(wlan_mac_reset_regs)];
+	uint32_t val, start;
+	unsigned int i;
 
 #ifdef CONFIG_CARL9170FW_RADIO_FUNCTIONS
 	uint32_t rx_BB;
@@ -278,19 +339,10 @@ static void wlan_mac_reset(void)
 	INFO("MAC RESET");
 #endif /* CONFIG_CARL9170FW_NOISY_MAC_RESET */
 
-	/* Save aggregation parameters */
-	agg_wait_counter = get(AR9170_MAC_REG_AMPDU_FACTOR);
-	agg_density = get(AR9170_MAC_REG_AMPDU_DENSITY);
-
-	bcn_start_addr = get(AR9170_MAC_REG_BCN_ADDR);
+	start = get_clock_counter();
 
-	cam_mode = get(AR9170_MAC_REG_CAM_MODE);
-	rctl = get(AR9170_MAC_REG_CAM_ROLL_CALL_TBL_L);
-	rcth = get(AR9170_MAC_REG_CAM_ROLL_CALL_TBL_H);
-
-	ack_power = get(AR9170_MAC_REG_ACK_TPC);
-	rts_cts_tpc = get(AR9170_MAC_REG_RTS_CTS_TPC);
-	rts_cts_rate = get(AR9170_MAC_REG_RTS_CTS_RATE);
+	for (i = 0; i < ARRAY_SIZE(wlan_mac_reset_regs); i++)
+		regs[i] = get(wlan_mac_reset_regs[i]);
 
 #ifdef CONFIG_CARL9170FW_RADIO_FUNCTIONS
 	/* 0x1c8960 write only */
@@ -321,18 +373,8 @@ static void wlan_mac_reset(void)
 
 	delay(2);
 
-	/* Restore aggregation parameters */
-	set(AR9170_MAC_REG_AMPDU_FACTOR, agg_wait_counter);
-	set(AR9170_MAC_REG_AMPDU_DENSITY, agg_density);
-
-	set(AR9170_MAC_REG_BCN_ADDR, bcn_start_addr);
-	set(AR9170_MAC_REG_CAM_MODE, cam_mode);
-	set(AR9170_MAC_REG_CAM_ROLL_CALL_TBL_L, rctl);
-	set(AR9170_MAC_REG_CAM_ROLL_CALL_TBL_H, rcth);
-
-	set(AR9170_MAC_REG_RTS_CTS_TPC, rts_cts_tpc);
-	set(AR9170_MAC_REG_ACK_TPC, ack_power);
-	set(AR9170_MAC_REG_RTS_CTS_RATE, rts_cts_rate);
+	for (i = 0; i < ARRAY_SIZE(wlan_mac_reset_regs); i++)
+		set(wlan_mac_reset_regs[i], regs[i]);
 
 #ifdef CONFIG_CARL9170FW_RADIO_FUNCTIONS
 	set(AR9170_PHY_REG_SWITCH_CHAIN_2, rx_BB);
@@ -346,14 +388,14 @@ static void wlan_mac_reset(void)
 
 	val = AR9170_DMA_TRIGGER_RXQ;
 	/* Reinitialize all WLAN TX DMA queues. */
-	for (i = AR9170_TXQ_SPECIAL; i >= AR9170_TXQ0; i--) {
+	for (i = 0; i < __AR9170_NUM_TX_QUEUES; i++) {
 		struct dma_desc *iter;
 
 		__for_each_desc_bits(iter, &fw.wlan.tx_queue[i], AR9170_OWN_BITS_SW);
 
 		/* kill the stuck frame */
 		if (!is_terminator(&fw.wlan.tx_queue[i], iter) &&
-		    fw.wlan.last_super_num[i] >= CARL9170FW_TX_MAC_RESET &&
+		    (fw.wlan.hang_reset & BIT(i)) &&
 		    fw.wlan.last_super[i] == DESC_PAYLOAD(iter)) {
 			struct carl9170_tx_superframe *super = get_super(iter);
 
@@ -369,7 +411,6 @@ static void wlan_mac_reset(void)
 			super->s.cnt = CARL9170_TX_MAX_RATE_TRIES;
 			super->s.rix = CARL9170_TX_MAX_RETRY_RATES;
 
-			fw.wlan.last_super_num[i] = 0;
 			fw.wlan.last_super[i] = NULL;
 			iter = iter->lastAddr->nextAddr;
 		}
@@ -388,6 +429,12 @@ static void wlan_mac_reset(void)
 
 	set(AR9170_MAC_REG_DMA_RXQ_ADDR, (uint32_t) fw.wlan.rx_queue.head);
 	wlan_trigger(val);
+
+	fw.stats.mac_reset.resets[fw.wlan.mac_reset_cause]++;
+	fw.stats.mac_reset.last_cause = fw.wlan.mac_reset_cause;
+	fw.stats.mac_reset.duration = get_clock_counter() - start;
+	fw.stats.mac_reset.max_duration = max(fw.stats.mac_reset.max_duration,
+					      fw.stats.mac_reset.duration);
 }
 #else
 static void wlan_mac_reset(void)
@@ -397,15 +444,143 @@ static void wlan_mac_reset(void)
 }
 #endif /* CONFIG_CARL9170FW_FW_MAC_RESET */
 
+static unsigned int wlan_hang_usecs(const unsigned int qidx)
+{
+	return (fw.tally_clock - fw.wlan.last_super_time[qidx]) /
+		fw.ticks_per_usec;
+}
+
+static void wlan_hang_recovered(const unsigned int qidx)
+{
+	struct carl9170_hang_stats *stats = &fw.stats.hang[qidx];
+
+	stats->hang_time = wlan_hang_usecs(qidx);
+	stats->max_hang_time = max(stats->max_hang_time, stats->hang_time);
+	stats->recovery_time = (fw.tally_clock - fw.wlan.hang_detect_time[qidx]) /
+		fw.ticks_per_usec;
+
+	fw.wlan.hang_detected &= ~BIT(qidx);
+	fw.wlan.hang_reset &= ~BIT(qidx);
+}
+
+void wlan_tx_progress(const unsigned int qidx)
+{
+	if (unlikely(fw.wlan.hang_detected & BIT(qidx)))
+		wlan_hang_recovered(qidx);
+
+	/* update hangcheck */
+	fw.wlan.last_super_time[qidx] = fw.tally_clock;
+}
+
+void wlan_check_hang(void)
+{
+	struct dma_desc *desc;
+	unsigned int stuck;
+	int i;
+
+	/*
+	 * This runs from the janitor. So, unlike the 25/50/100ms timer,
+	 * the resolution of the thresholds is CARL9170_HANG_CHECK_USECS.
+	 */
+	if ((fw.tally_clock - fw.wlan.hang_check_time) <
+	    (CARL9170_HANG_CHECK_USECS * fw.ticks_per_usec))
+		return;
+
+	fw.wlan.hang_check_time = fw.tally_clock;
+
+	for (i = AR9170_TXQ_SPECIAL; i >= AR9170_TXQ0; i--) {
+		if (queue_empty(&fw.wlan.tx_queue[i])) {
+			/* Nothing to do here... move along */
+			if (unlikely(fw.wlan.hang_detected & BIT(i)))
+				wlan_hang_recovered(i);
+
+			fw.wlan.last_super[i] = NULL;
+			continue;
+		}
+
+		/* fetch the current DMA queue position */
+		desc = (struct dma_desc *)get_wlan_txq_addr(i);
+
+		/* Stuck frame detection */
+		if (unlikely(DESC_PAYLOAD(desc) == fw.wlan.last_super[i])) {
+			stuck = wlan_hang_usecs(i);
+
+			if (stuck < fw.wlan.hang_bump_usecs)
+				continue;
+
+			if (!(fw.wlan.hang_detected & BIT(i))) {
+				fw.wlan.hang_detected |= BIT(i);
+				fw.wlan.hang_detect_time[i] = fw.tally_clock;
+				fw.stats.hang[i].hangs++;
+
+#ifdef CONFIG_CARL9170FW_DMA_QUEUE_BUMP
+				/*
+				 * Hrrm, bump the queue a bit.
+				 * maybe this will get it going again.
+				 */
+
+				wlan_dma_bump(i);
+				wlan_trigger(BIT(i));
+#endif /* CONFIG_CARL9170FW_DMA_QUEUE_BUMP */
+			}
+
+#ifdef CONFIG_CARL9170FW_DEBUG
+			if (unlikely(stuck >= fw.wlan.hang_debug_usecs &&
+				     !(fw.wlan.hang_dumped & BIT(i)))) {
+				/*
+				 * Sigh, the queue is almost certainly
+				 * dead. Dump the queue content to the
+				 * user, maybe we find out why it got
+				 * so stuck.
+				 */
+
+				fw.wlan.hang_dumped |= BIT(i);
+				wlan_dump_queue(i);
+			}
+#endif /* CONFIG_CARL9170FW_DEBUG */
+
+			if (unlikely(stuck >= fw.wlan.hang_reset_usecs &&
+				     !(fw.wlan.hang_reset & BIT(i)))) {
+				/*
+				 * schedule MAC reset (aka OFF/ON => dead)
+				 *
+				 * This will almost certainly kill
+				 * the device for good, but it's the
+				 * recommended thing to do...
+				 */
+
+				fw.wlan.hang_reset |= BIT(i);
+				fw.stats.hang[i].resets++;
+				fw.wlan.mac_reset = CARL9170_MAC_RESET_RESET;
+				fw.wlan.mac_reset_cause = CARL9170_MAC_RESET_CAUSE_TX_HANG;
+			}
+		} else {
+			/* Nothing stuck */
+			if (unlikely(fw.wlan.hang_detected & BIT(i)))
+				wlan_hang_recovered(i);
+
+			fw.wlan.last_super[i] = DESC_PAYLOAD(desc);
+			fw.wlan.last_super_time[i] = fw.tally_clock;
+		}
+	}
+
+#ifdef CONFIG_CARL9170FW_DEBUG
+	fw.wlan.hang_dumped &= fw.wlan.hang_detected;
+#endif /* CONFIG_CARL9170FW_DEBUG */
+
+	/* don't wait for the next wlan_timer */
+	if (unlikely(fw.wlan.mac_reset >= CARL9170_MAC_RESET_RESET)) {
+		wlan_mac_reset();
+		fw.wlan.mac_reset = CARL9170_MAC_RESET_OFF;
+	}
+}
+
 void __cold wlan_timer(void)
 {
 	unsigned int cached_mac_reset;
 
 	cached_mac_reset = fw.wlan.mac_reset;
 
-	/* TX Queue Hang check */
-	wlan_check_hang();
-
 	/* RX Overrun check */
 	wlan_check_rx_overrun();
 
@@ -85,6 +85,415 @@ static void handle_bar(struct dma_desc *desc __unused, struct ieee80211_hdr *hdr
 	ctx->start_seq_num = bar->start_seq_num;
 }
 
+/*
+ * Remembers the last sequence control field of every (TA, TID).
+ * A frame with the retry bit set and the same sequence and
+ * fragment number has already been received.
+ */
+static bool wlan_rx_is_dup(struct ieee80211_hdr *hdr, unsigned int len,
+			   const unsigned int hdr_len)
+{
+	struct carl9170_rx_dup_ctx *ctx;
+	const uint16_t *ta = (const uint16_t *) hdr->addr2;
+	unsigned int i, tid;
+
+	if (len < hdr_len + FCS_LEN ||
+	    is_multicast_ether_addr(hdr->addr1))
+		return false;
+
+	if (ieee80211_is_data_qos(hdr->frame_control))
+		tid = ieee80211_get_tid(hdr);
+	else
+		tid = IEEE80211_NUM_TIDS;
+
+	for (i = 0; i < CARL9170_RX_DUP_CACHE_NUM; i++) {
+		ctx = &fw.wlan.rx_dup_cache[i];
+
+		if (ctx->tid != tid || ((ctx->ta[0] ^ ta[0]) |
+		    (ctx->ta[1] ^ ta[1]) | (ctx->ta[2] ^ ta[2])))
+			continue;
+
+		if (ieee80211_has_retry(hdr->frame_control) &&
+		    ctx->seq_ctrl == hdr->seq_ctrl)
+			return true;
+
+		ctx->seq_ctrl = hdr->seq_ctrl;
+		return false;
+	}
+
+	ctx = &fw.wlan.rx_dup_cache[fw.wlan.rx_dup_idx];
+	fw.wlan.rx_dup_idx++;
+	fw.wlan.rx_dup_idx %= CARL9170_RX_DUP_CACHE_NUM;
+
+	ctx->ta[0] = ta[0];
+	ctx->ta[1] = ta[1];
+	ctx->ta[2] = ta[2];
+	ctx->tid = tid;
+	ctx->seq_ctrl = hdr->seq_ctrl;
+	return false;
+}
+
+static bool wlan_rx_mcast_miss(struct ieee80211_hdr *hdr)
+{
+	unsigned int i;
+
+	if (!is_multicast_ether_addr(hdr->addr1) ||
+	    is_broadcast_ether_addr(hdr->addr1))
+		return false;
+
+	for (i = 0; i < fw.wlan.mcast_num; i++) {
+		if (compare_ether_address(hdr->addr1, fw.wlan.mcast_addr[i])) {
+			fw.stats.mcast.hits++;
+			return false;
+		}
+	}
+
+	fw.stats.mcast.misses++;
+	return true;
+}
+
+static bool wlan_rx_bcn_same(struct dma_desc *desc, struct ieee80211_hdr *hdr,
+			     unsigned int len)
+{
+	struct ieee80211_mgmt *mgmt = (void *) hdr;
+	struct dma_desc *tmp = desc;
+	const uint8_t *pos, *end;
+	uint32_t hash = 5381;
+	bool traffic = false, hash_ie = true;
+	unsigned int i, left, eid = 0, ie_pos = 0, ie_len = 0, tim_n1 = 0;
+	const unsigned int aid = fw.wlan.bcn_filter_aid & 0x3fff;
+
+	if (!compare_ether_address(hdr->addr3, (const void *) AR9170_MAC_REG_BSSID_L))
+		return false;
+
+	if (len < offsetof(struct ieee80211_mgmt, u.beacon.variable) + FCS_LEN)
+		return false;
+
+	/* skip the timestamp, but include interval and capabilities */
+	pos = (const uint8_t *) &mgmt->u.beacon.beacon_int;
+	end = DESC_PAYLOAD_OFF(desc, desc->dataSize);
+	left = len - FCS_LEN - offsetof(struct ieee80211_mgmt, u.beacon.beacon_int);
+
+	/* the IEs of larger beacons continue in the next rx blocks */
+	for (i = 0; i < left; i++, pos++) {
+		if (pos >= end) {
+			if (tmp == desc->lastAddr)
+				return false;
+
+			tmp = tmp->nextAddr;
+			pos = DESC_PAYLOAD(tmp);
+			end = DESC_PAYLOAD_OFF(tmp, tmp->dataSize);
+		}
+
+		if (i < 4) {
+			hash = ((hash << 5) | (hash >> 27)) ^ *pos;
+			continue;
+		}
+
+		switch (ie_pos) {
+		case 0:
+			eid = *pos;
+			hash_ie = eid != WLAN_EID_TIM ||
+				  (fw.wlan.bcn_filter_flags & CARL9170_BCN_FILTER_HASH_TIM);
+			break;
+		case 1:
+			ie_len = *pos;
+			break;
+		default:
+			if (eid != WLAN_EID_TIM ||
+			    ie_len < sizeof(struct ieee80211_tim_ie))
+				break;
+
+			/* see ieee80211_check_tim, one byte at a time */
+			if (ie_pos == 4) {
+				tim_n1 = *pos & 0xfe;
+				if (*pos & 1)
+					traffic = true;
+			} else if (ie_pos > 4 && aid &&
+				   tim_n1 + ie_pos - 5 == aid / 8 &&
+				   (*pos & BIT(aid & 7))) {
+				traffic = true;
+			}
+			break;
+		}
+
+		if (hash_ie)
+			hash = ((hash << 5) | (hash >> 27)) ^ *pos;
+
+		if (++ie_pos >= 2 && ie_pos == 2 + ie_len)
+			ie_pos = 0;
+	}
+
+	if (!traffic && hash == fw.wlan.bcn_filter_hash &&
+	    (!fw.wlan.bcn_filter_keepalive ||
+	     (fw.tally_clock - fw.wlan.bcn_filter_time) / fw.ticks_per_usec <
+	     fw.wlan.bcn_filter_keepalive))
+		return true;
+
+	fw.wlan.bcn_filter_hash = hash;
+	fw.wlan.bcn_filter_time = fw.tally_clock;
+	return false;
+}
+
+static const uint8_t wlan_tid_to_txq[IEEE80211_NUM_TIDS / 2] = {
+	AR9170_TXQ_BE, AR9170_TXQ_BK, AR9170_TXQ_BK, AR9170_TXQ_BE,
+	AR9170_TXQ_VI, AR9170_TXQ_VI, AR9170_TXQ_VO, AR9170_TXQ_VO,
+};
+
+/*
+ * While the upload path is backed up, data frames are the first to go.
+ * Null data frames (PM bit) and EAPOL frames are kept.
+ */
+static bool wlan_rx_congested(struct ieee80211_hdr *hdr, unsigned int len,
+			      const unsigned int hdr_len)
+{
+	static const uint8_t eapol_snap[8] = {
+		0xaa, 0xaa, 0x03, 0x00, 0x00, 0x00, 0x88, 0x8e };
+	struct carl9170_rx_congestion_stats *stats = &fw.stats.rx_congestion;
+	unsigned int off;
+
+	stats->max_backlog = max(stats->max_backlog, fw.wlan.rx_up_pending);
+	if (likely(fw.wlan.rx_up_pending < CARL9170_RX_CONGESTION_THRESHOLD))
+		return false;
+
+	/* the IV of a decrypted TKIP/CCMP frame is still there */
+	off = hdr_len;
+	if (ieee80211_has_protected(hdr->frame_control))
+		off += 8;
+
+	if (ieee80211_is_any_nullfunc(hdr->frame_control) ||
+	    (len >= off + sizeof(eapol_snap) + FCS_LEN &&
+	     !memcmp((uint8_t *) hdr + off, eapol_snap, sizeof(eapol_snap)))) {
+		stats->kept++;
+		return false;
+	}
+
+	if (ieee80211_is_data_qos(hdr->frame_control))
+		stats->dropped[wlan_tid_to_txq[ieee80211_get_tid(hdr) & 7]]++;
+	else
+		stats->dropped[AR9170_TXQ_BE]++;
+
+	stats->dropped_bytes += len;
+	return true;
+}
+
+#ifdef CONFIG_CARL9170FW_RX_STA_TABLE
+void wlan_rx_sta_clear(const unsigned int slot)
+{
+	BUILD_BUG_ON(CARL9170_RX_STA_NUM > 32);
+
+	memset(&dma_mem.reserved.rx_sta.sta[slot], 0,
+	       sizeof(dma_mem.reserved.rx_sta.sta[slot]));
+	memset(&dma_mem.reserved.rx_sta.rates[slot], 0,
+	       sizeof(dma_mem.reserved.rx_sta.rates[slot]));
+	fw.wlan.rx_sta_rssi &= ~BIT(slot);
+}
+
+static unsigned int wlan_rx_sta_get(const uint8_t *ta)
+{
+	struct carl9170_rx_sta_stats *sta = dma_mem.reserved.rx_sta.sta;
+	unsigned int i, lru = 0, empty = CARL9170_RX_STA_NUM;
+
+	/* cleared slots can sit anywhere in the table */
+	for (i = 0; i < CARL9170_RX_STA_NUM; i++) {
+		if (!sta[i].frames) {
+			if (empty == CARL9170_RX_STA_NUM)
+				empty = i;
+			continue;
+		}
+
+		if (!memcmp(sta[i].ta, ta, sizeof(sta[i].ta)))
+			return i;
+
+		if ((fw.tally_clock - sta[i].last_seen) >
+		    (fw.tally_clock - sta[lru].last_seen))
+			lru = i;
+	}
+
+	/* new transmitter: take a free slot or evict the oldest one */
+	if (empty != CARL9170_RX_STA_NUM)
+		lru = empty;
+
+	wlan_rx_sta_clear(lru);
+	memcpy(sta[lru].ta, ta, sizeof(sta[lru].ta));
+	return lru;
+}
+
+static void wlan_rx_sta(struct dma_desc *desc, struct ieee80211_hdr *hdr,
+			unsigned int len)
+{
+	struct carl9170_rx_sta_stats *sta;
+	struct ar9170_rx_phystatus *phy;
+	struct ar9170_tx_hw_phy_control rate;
+	unsigned int slot, bucket;
+	int rssi;
+
+	if (len < offsetof(struct ieee80211_hdr, addr3) + FCS_LEN)
+		return;
+
+	slot = wlan_rx_sta_get(hdr->addr2);
+	sta = &dma_mem.reserved.rx_sta.sta[slot];
+	sta->frames++;
+	sta->bytes += len;
+	sta->last_seen = fw.tally_clock;
+
+	/* only the first MPDU of an aggregate has the PLCP header */
+	if (ar9170_get_rx_head(desc)) {
+		rate.set = ar9170_rx_to_phy(desc);
+		switch (rate.modulation) {
+		case AR9170_TX_PHY_MOD_CCK:
+			bucket = rate.mcs & 3;
+			break;
+		case AR9170_TX_PHY_MOD_HT:
+			bucket = 12 + (rate.mcs & 15);
+			break;
+		default:
+			bucket = 4 + (rate.mcs & 7);
+			break;
+		}
+
+		dma_mem.reserved.rx_sta.rates[slot].rates[bucket]++;
+	}
+
+	/* ... and only the last one has the phy status */
+	switch (ar9170_get_rx_macstatus_status(desc) & AR9170_RX_STATUS_MPDU) {
+	case AR9170_RX_STATUS_MPDU_LAST:
+	case AR9170_RX_STATUS_MPDU_SINGLE:
+		if (desc->lastAddr->dataSize < sizeof(struct ar9170_rx_phystatus) +
+					       sizeof(struct ar9170_rx_macstatus))
+			return;
+
+		phy = DESC_PAYLOAD_OFF(desc->lastAddr, desc->lastAddr->dataSize -
+			sizeof(struct ar9170_rx_phystatus) -
+			sizeof(struct ar9170_rx_macstatus));
+
+		/* 0x80 marks an invalid reading */
+		if (phy->rssi_combined == 0x80)
+			return;
+
+		rssi = (int8_t) phy->rssi_combined;
+		if (fw.wlan.rx_sta_rssi & BIT(slot)) {
+			sta->rssi = (sta->rssi * 7 + rssi) / 8;
+		} else {
+			sta->rssi = rssi;
+			fw.wlan.rx_sta_rssi |= BIT(slot);
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+#endif /* CONFIG_CARL9170FW_RX_STA_TABLE */
+
+#ifdef CONFIG_CARL9170FW_PS_POLL_OFFLOAD
+static bool wlan_rx_pspoll(struct ieee80211_hdr *hdr, unsigned int len)
+{
+	struct ieee80211_pspoll *pspoll = (void *) hdr;
+	unsigned int i, aid;
+
+	if (len < sizeof(struct ieee80211_pspoll) + FCS_LEN)
+		return false;
+
+	aid = le16_to_cpu(pspoll->aid) & 0x3fff;
+	for (i = 0; i < CARL9170_PS_STA_NUM; i++) {
+		if (!fw.wlan.ps_aid[i] || fw.wlan.ps_aid[i] != aid ||
+		    memcmp(hdr->addr2, fw.wlan.ps_addr[i], 6))
+			continue;
+
+		fw.stats.ps[i].polls++;
+
+		/* nothing left, the application has to answer */
+		if (!wlan_ps_poll(i)) {
+			fw.stats.ps[i].empty_polls++;
+			return false;
+		}
+
+		fw.stats.ps[i].released++;
+		fw.wlan.ps_poll_time[i] = fw.tally_clock;
+		fw.wlan.ps_pending |= BIT(i);
+		return true;
+	}
+
+	return false;
+}
+
+/* QoS Data/Null frames from a dozing U-APSD station are trigger frames */
+static bool wlan_rx_trigger(struct ieee80211_hdr *hdr, unsigned int len)
+{
+	unsigned int i;
+
+	if (!ieee80211_is_data_qos(hdr->frame_control) ||
+	    !ieee80211_has_pm(hdr->frame_control) ||
+	    len < ieee80211_hdrlen(hdr->frame_control) + FCS_LEN)
+		return false;
+
+	for (i = 0; i < CARL9170_PS_STA_NUM; i++) {
+		if (!fw.wlan.ps_aid[i] || !fw.wlan.ps_uapsd[i] ||
+		    memcmp(hdr->addr2, fw.wlan.ps_addr[i], 6))
+			continue;
+
+		return wlan_ps_trigger(i,
+			wlan_tid_to_txq[ieee80211_get_tid(hdr) & 7]);
+	}
+
+	return false;
+}
+#endif /* CONFIG_CARL9170FW_PS_POLL_OFFLOAD */
+
+#ifdef CONFIG_CARL9170FW_PROBE_RESP_OFFLOAD
+static bool wlan_rx_probe_req(struct dma_desc *desc, struct ieee80211_hdr *hdr,
+			      unsigned int len)
+{
+	struct ieee80211_mgmt *mgmt = (void *) hdr;
+	struct carl9170_probe_resp_stats *stats;
+	const uint8_t *ssid, *tmpl, *end;
+	bool answered = false, escalated = false;
+	unsigned int vif;
+
+	/* the SSID is the first IE, it has to be in the first block */
+	ssid = mgmt->u.probe_req.variable;
+	end = min((const uint8_t *) hdr + len - FCS_LEN,
+		  (const uint8_t *) DESC_PAYLOAD(desc) + desc->dataSize);
+	if (ssid + 2 > end || ssid[0] != WLAN_EID_SSID || ssid + 2 + ssid[1] > end)
+		ssid = NULL;
+
+	for (vif = 0; vif < CARL9170_INTF_NUM; vif++) {
+		tmpl = fw.wlan.probe_ssid[vif];
+		if (!tmpl)
+			continue;
+
+		stats = &fw.stats.probe_resp[vif];
+		stats->requests++;
+
+		if (!ssid) {
+			stats->escalated++;
+			escalated = true;
+			continue;
+		}
+
+		/* 802.11-2007 11.1.3.2.1: wildcard or our SSID and BSSID */
+		if ((ssid[1] && (ssid[1] != tmpl[1] ||
+		     memcmp(&ssid[2], &tmpl[2], ssid[1]))) ||
+		    (!is_broadcast_ether_addr(hdr->addr3) &&
+		     memcmp(hdr->addr3,
+			    wlan_probe_resp_tmpl(vif)->f.data.i3e.addr3, 6)))
+			continue;
+
+		if (wlan_send_probe_resp(vif, hdr->addr2)) {
+			stats->answered++;
+			answered = true;
+		} else {
+			stats->escalated++;
+			escalated = true;
+		}
+	}
+
+	/* the application has to answer for the remaining interfaces */
+	return answered && !escalated;
+}
+#endif /* CONFIG_CARL9170FW_PROBE_RESP_OFFLOAD */
+
 static unsigned int wlan_rx_filter(struct dma_desc *desc)
 {
 	struct ieee80211_hdr *hdr;
@@ -116,8 +525,38 @@ static unsigned int wlan_rx_filter(struct dma_desc *desc)
 		rx_filter |= CARL9170_RX_FILTER_DECRY_FAIL;
 
 	hdr = ar9170_get_rx_i3e(desc);
+
+#ifdef CONFIG_CARL9170FW_RX_STA_TABLE
+	/* control frames don't always have a transmitter address */
+	if (!ieee80211_is_ctl(hdr->frame_control))
+		wlan_rx_sta(desc, hdr, data_len);
+#endif /* CONFIG_CARL9170FW_RX_STA_TABLE */
+
 	if (likely(ieee80211_is_data(hdr->frame_control))) {
+		const unsigned int hdr_len = ieee80211_hdrlen(hdr->frame_control);
+
 		rx_filter |= CARL9170_RX_FILTER_DATA;
+
+#ifdef CONFIG_CARL9170FW_PS_POLL_OFFLOAD
+		/* QoS Data triggers still carry a payload for the host */
+		if (!(mac_err & AR9170_RX_ERROR_WRONG_RA) &&
+		    wlan_rx_trigger(hdr, data_len) &&
+		    ieee80211_is_qos_nullfunc(hdr->frame_control))
+			rx_filter |= CARL9170_RX_FILTER_PS_DONE;
+#endif /* CONFIG_CARL9170FW_PS_POLL_OFFLOAD */
+
+		if ((fw.wlan.rx_filter & CARL9170_RX_FILTER_MCAST_MISS) &&
+		    wlan_rx_mcast_miss(hdr))
+			rx_filter |= CARL9170_RX_FILTER_MCAST_MISS;
+
+		if ((fw.wlan.rx_filter & CARL9170_RX_FILTER_DUPLICATE) &&
+		    !(mac_err & AR9170_RX_ERROR_WRONG_RA) &&
+		    wlan_rx_is_dup(hdr, data_len, hdr_len))
+			rx_filter |= CARL9170_RX_FILTER_DUPLICATE;
+
+		if ((fw.wlan.rx_filter & CARL9170_RX_FILTER_CONGESTED) &&
+		    wlan_rx_congested(hdr, data_len, hdr_len))
+			rx_filter |= CARL9170_RX_FILTER_CONGESTED;
 	} else if (ieee80211_is_ctl(hdr->frame_control)) {
 		switch (le16_to_cpu(hdr->frame_control) & IEEE80211_FCTL_STYPE) {
 		case IEEE80211_STYPE_BACK_REQ:
@@ -125,6 +564,13 @@ static unsigned int wlan_rx_filter(struct dma_desc *desc)
 			rx_filter |= CARL9170_RX_FILTER_CTL_BACKR;
 			break;
 		case IEEE80211_STYPE_PSPOLL:
+#ifdef CONFIG_CARL9170FW_PS_POLL_OFFLOAD
+			if (!(mac_err & AR9170_RX_ERROR_WRONG_RA) &&
+			    wlan_rx_pspoll(hdr, data_len)) {
+				rx_filter |= CARL9170_RX_FILTER_PS_DONE;
+				break;
+			}
+#endif /* CONFIG_CARL9170FW_PS_POLL_OFFLOAD */
 			rx_filter |= CARL9170_RX_FILTER_CTL_PSPOLL;
 			break;
 		case IEEE80211_STYPE_BACK:
@@ -145,6 +591,19 @@ static unsigned int wlan_rx_filter(struct dma_desc *desc)
 	} else {
 		/* ieee80211_is_mgmt */
 		rx_filter |= CARL9170_RX_FILTER_MGMT;
+
+		if ((fw.wlan.rx_filter & CARL9170_RX_FILTER_BCN_SAME) &&
+		    ieee80211_is_beacon(hdr->frame_control) &&
+		    wlan_rx_bcn_same(desc, hdr, data_len))
+			rx_filter |= CARL9170_RX_FILTER_BCN_SAME;
+
+#ifdef CONFIG_CARL9170FW_PROBE_RESP_OFFLOAD
+		if (ieee80211_is_probe_req(hdr->frame_control) &&
+		    (is_broadcast_ether_addr(hdr->addr1) ||
+		     !(mac_err & AR9170_RX_ERROR_WRONG_RA)) &&
+		    wlan_rx_probe_req(desc, hdr, data_len))
+			rx_filter |= CARL9170_RX_FILTER_PROBE_DONE;
+#endif /* CONFIG_CARL9170FW_PROBE_RESP_OFFLOAD */
 	}
 
 	if (unlikely(fw.suspend_mode == CARL9170_HOST_SUSPENDED)) {
@@ -157,17 +616,426 @@ static unsigned int wlan_rx_filter(struct dma_desc *desc)
 	return rx_filter;
 }
 
+static void wlan_rx_filter_stats(unsigned int rx_class, const bool drop,
+				 const unsigned int len)
+{
+	struct carl9170_rx_filter_stats *stats = fw.stats.rx_filter;
+
+	for (; rx_class; rx_class >>= 1, stats++) {
+		if (!(rx_class & 1))
+			continue;
+
+		if (drop) {
+			stats->dropped++;
+			stats->dropped_bytes += len;
+		} else {
+			stats->passed++;
+			stats->passed_bytes += len;
+		}
+	}
+}
+
+#ifdef CONFIG_CARL9170FW_RX_DECAP
+static struct ar9170_rx_macstatus *wlan_rx_macstatus(struct dma_desc *desc)
+{
+	return DESC_PAYLOAD_OFF(desc->lastAddr, desc->lastAddr->dataSize -
+		sizeof(struct ar9170_rx_macstatus));
+}
+
+/* IV length of a frame the hardware has decrypted, 0 if it hasn't */
+static unsigned int wlan_rx_iv_len(struct dma_desc *desc)
+{
+	switch (ar9170_get_decrypt_type(wlan_rx_macstatus(desc))) {
+	case AR9170_ENC_ALG_WEP64:
+	case AR9170_ENC_ALG_WEP128:
+	case AR9170_ENC_ALG_WEP256:
+		return 4;
+	case AR9170_ENC_ALG_TKIP:
+	case AR9170_ENC_ALG_AESCCMP:
+		return 8;
+	default:
+		return 0;
+	}
+}
+
+static bool wlan_rx_can_decap(struct dma_desc *desc, struct ieee80211_hdr *hdr,
+			      const uint8_t *snap)
+{
+	static const uint8_t rfc1042[6] = { 0xaa, 0xaa, 0x03, 0x00, 0x00, 0x00 };
+	static const uint8_t bridge_tunnel[6] = { 0xaa, 0xaa, 0x03, 0x00, 0x00, 0xf8 };
+	const __le16 fc = hdr->frame_control;
+	uint8_t qos[2];
+
+	if (ieee80211_has_a4(fc) || ieee80211_has_morefrags(fc) ||
+	    (hdr->seq_ctrl & cpu_to_le16(IEEE80211_SCTL_FRAG)) ||
+	    ar9170_get_rx_macstatus_error(desc))
+		return false;
+
+	if (ieee80211_is_data_qos(fc)) {
+		memcpy(qos, ieee80211_get_qos_ctl(hdr), sizeof(qos));
+		if (qos[0] & IEEE80211_QOS_CTL_A_MSDU_PRESENT)
+			return false;
+	}
+
+	/* the whole SNAP header has to be in the first block */
+	if ((unsigned int)(snap + 8 - (uint8_t *) DESC_PAYLOAD(desc)) > desc->dataSize ||
+	    ar9170_get_rx_mpdu_len(desc) < (unsigned int)(snap + 8 - (uint8_t *) hdr) + FCS_LEN)
+		return false;
+
+	/* same as ieee80211_data_to_8023: AppleTalk ARP and IPX keep theirs */
+	if (!memcmp(snap, rfc1042, sizeof(rfc1042)))
+		return !((snap[6] == 0x80 && snap[7] == 0xf3) ||
+			 (snap[6] == 0x81 && snap[7] == 0x37));
+
+	return !memcmp(snap, bridge_tunnel, sizeof(bridge_tunnel));
+}
+
+/*
+ * The new header goes right in front of the payload, the IV of a
+ * decrypted frame in front of it and the PLCP head stays where it
+ * is. Everything in between is cut out of the first block, the
+ * phy/mac status of single block frames moves along.
+ */
+static void wlan_rx_decap(struct dma_desc *desc)
+{
+	struct ieee80211_hdr *hdr = ar9170_get_rx_i3e(desc);
+	struct carl9170_rx_decap_hdr decap;
+	uint8_t *snap, *start;
+	unsigned int delta, iv_len = 0;
+
+	if (!ieee80211_is_data_present(hdr->frame_control))
+		return;
+
+	/* the mac status gets the flag */
+	if (desc->lastAddr->dataSize < sizeof(struct ar9170_rx_macstatus))
+		goto skip;
+
+	snap = (uint8_t *) hdr + ieee80211_hdrlen(hdr->frame_control);
+
+	/* software decryption is left to the host */
+	if (ieee80211_has_protected(hdr->frame_control)) {
+		iv_len = wlan_rx_iv_len(desc);
+		if (!iv_len)
+			goto skip;
+
+		snap += iv_len;
+	}
+
+	if (!wlan_rx_can_decap(desc, hdr, snap))
+		goto skip;
+
+	decap.frame_control = hdr->frame_control;
+	decap.seq_ctrl = hdr->seq_ctrl;
+	decap.qos_ctrl = 0;
+	if (ieee80211_is_data_qos(hdr->frame_control))
+		memcpy(&decap.qos_ctrl, ieee80211_get_qos_ctl(hdr),
+		       sizeof(decap.qos_ctrl));
+	memcpy(decap.h_dest, ieee80211_get_DA(hdr), sizeof(decap.h_dest));
+	memcpy(decap.h_source, ieee80211_get_SA(hdr), sizeof(decap.h_source));
+
+	/* the ethertype is already in place, the IV has to move */
+	start = snap + 8 - sizeof(decap) - iv_len;
+	memmove(start, snap - iv_len, iv_len);
+	memcpy(start + iv_len, &decap,
+	       offsetof(struct carl9170_rx_decap_hdr, h_proto));
+
+	delta = start - (uint8_t *) hdr;
+	memmove(hdr, start, desc->dataSize -
+		(start - (uint8_t *) DESC_PAYLOAD(desc)));
+	desc->dataSize -= delta;
+	desc->totalLen -= delta;
+	wlan_rx_macstatus(desc)->error |= CARL9170_RX_ERROR_DECAP;
+
+	fw.stats.rx_decap.frames++;
+	fw.stats.rx_decap.saved_bytes += delta;
+	return;
+
+skip:
+	fw.stats.rx_decap.skipped++;
+}
+#endif /* CONFIG_CARL9170FW_RX_DECAP */
+
+#ifdef CONFIG_CARL9170FW_RX_TSF
+#define CARL9170_RX_STAMP_OFF	(sizeof(struct ar9170_rx_macstatus) +		\
+				 sizeof(struct ar9170_rx_phystatus) -		\
+				 offsetof(struct ar9170_rx_phystatus, evm_stream0))
+
+static void wlan_rx_stamp(struct dma_desc *desc, const uint32_t stamp[2])
+{
+	const uint8_t *src = (const void *) stamp;
+	struct dma_desc *tmp = desc->lastAddr;
+	unsigned int off, pos, i;
+
+	switch (ar9170_get_rx_macstatus_status(desc) & AR9170_RX_STATUS_MPDU) {
+	case AR9170_RX_STATUS_MPDU_LAST:
+	case AR9170_RX_STATUS_MPDU_SINGLE:
+		break;
+
+	default:
+		return;
+	}
+
+	if (unlikely(desc->totalLen < sizeof(struct ar9170_rx_head) +
+				      CARL9170_RX_STAMP_OFF))
+		return;
+
+	if (likely(tmp->dataSize >= CARL9170_RX_STAMP_OFF)) {
+		memcpy(DESC_PAYLOAD_OFF(tmp, tmp->dataSize - CARL9170_RX_STAMP_OFF),
+		       stamp, 2 * sizeof(uint32_t));
+		return;
+	}
+
+	/* the stamp is split between the last two blocks */
+	off = desc->totalLen - CARL9170_RX_STAMP_OFF;
+	for (tmp = desc, pos = 0, i = 0; ; tmp = tmp->nextAddr) {
+		for (; i < 2 * sizeof(uint32_t) && off + i < pos + tmp->dataSize; i++)
+			*((uint8_t *) DESC_PAYLOAD_OFF(tmp, off + i - pos)) = src[i];
+
+		pos += tmp->dataSize;
+		if (tmp == desc->lastAddr)
+			break;
+	}
+}
+
+#undef CARL9170_RX_STAMP_OFF
+#endif /* CONFIG_CARL9170FW_RX_TSF */
+
+#ifdef CONFIG_CARL9170FW_RX_TRUNCATE
+static void wlan_rx_truncate(struct dma_desc *desc)
+{
+	uint32_t tail[1 + (sizeof(struct ar9170_rx_phystatus) +
+			   sizeof(struct ar9170_rx_macstatus)) / 4];
+	const unsigned int keep = fw.wlan.rx_truncate &
+				   ~(CARL9170_RX_TRUNCATE_ALIGN - 1);
+	unsigned int tail_len, start, pos, off, len, i;
+	struct dma_desc *tmp;
+
+	if (!keep)
+		return;
+
+	switch (ar9170_get_rx_macstatus_status(desc) & AR9170_RX_STATUS_MPDU) {
+	case AR9170_RX_STATUS_MPDU_LAST:
+	case AR9170_RX_STATUS_MPDU_SINGLE:
+		tail_len = sizeof(struct ar9170_rx_phystatus) +
+			   sizeof(struct ar9170_rx_macstatus);
+		break;
+
+	default:
+		tail_len = sizeof(struct ar9170_rx_macstatus);
+		break;
+	}
+
+	if (desc->totalLen <= keep + sizeof(tail[0]) + tail_len)
+		return;
+
+	/* save the original length and the status tail */
+	tail[0] = cpu_to_le32(desc->totalLen);
+	start = desc->totalLen - tail_len;
+	i = sizeof(tail[0]);
+	for (tmp = desc, pos = 0; ; tmp = tmp->nextAddr) {
+		if (pos + tmp->dataSize > start) {
+			off = start > pos ? start - pos : 0;
+			len = min(tmp->dataSize - off,
+				  sizeof(tail[0]) + tail_len - i);
+			memcpy((uint8_t *) tail + i,
+			       DESC_PAYLOAD_OFF(tmp, off), len);
+			i += len;
+		}
+
+		pos += tmp->dataSize;
+		if (tmp == desc->lastAddr)
+			break;
+	}
+
+	/* the other blocks can go back to the hardware right away */
+	if (desc->lastAddr != desc) {
+		tmp = desc->nextAddr;
+		tmp->lastAddr = desc->lastAddr;
+		desc->lastAddr = desc->nextAddr = desc;
+
+		wlan_rx_reclaim(tmp);
+	}
+
+	memcpy(DESC_PAYLOAD_OFF(desc, keep), tail, i);
+	desc->totalLen = desc->dataSize = keep + i;
+}
+#else
+static inline void wlan_rx_truncate(struct dma_desc *desc __unused)
+{
+}
+#endif /* CONFIG_CARL9170FW_RX_TRUNCATE */
+
+#ifdef CONFIG_CARL9170FW_RX_TEST
+static void wlan_rx_test(struct dma_desc *desc)
+{
+	struct ar9170_tx_hw_phy_control phy;
+	unsigned int mac_err, class;
+
+	fw.stats.rx_test.frames++;
+
+	mac_err = ar9170_get_rx_macstatus_error(desc);
+	if (mac_err & AR9170_RX_ERROR_FCS)
+		fw.stats.rx_test.fcs_errors++;
+	if (mac_err & AR9170_RX_ERROR_PLCP)
+		fw.stats.rx_test.plcp_errors++;
+	if (mac_err & (AR9170_RX_ERROR_FCS | AR9170_RX_ERROR_PLCP))
+		return;
+
+	fw.stats.rx_test.bytes += ar9170_get_rx_mpdu_len(desc);
+
+	/*
+	 * Only the first MPDU of an aggregate comes with the PLCP
+	 * header. The others were sent at the same rate.
+	 */
+	if (ar9170_get_rx_head(desc))
+		fw.wlan.rx_test_phy = ar9170_rx_to_phy(desc);
+
+	phy.set = fw.wlan.rx_test_phy;
+	switch (phy.modulation) {
+	case AR9170_TX_PHY_MOD_CCK:
+		class = CARL9170_RX_RATE_CCK;
+		break;
+	case AR9170_TX_PHY_MOD_HT:
+		/* one and two spatial stream MCS get a block each */
+		if (phy.mcs & 8)
+			class = CARL9170_RX_RATE_HT_2SS;
+		else
+			class = CARL9170_RX_RATE_HT;
+		break;
+	default:
+		class = CARL9170_RX_RATE_OFDM;
+		break;
+	}
+
+	fw.stats.rx_rates[class].frames[phy.mcs % CARL9170_RX_RATES_NUM]++;
+}
+#endif /* CONFIG_CARL9170FW_RX_TEST */
+
+#ifdef CONFIG_CARL9170FW_RX_BALANCE
+static inline bool is_tx_pool_desc(struct dma_desc *desc)
+{
+	return (uint8_t *) DESC_PAYLOAD(desc) <
+	       (uint8_t *) &dma_mem.data[AR9170_TX_BLOCK_NUMBER];
+}
+
+void wlan_tx_reclaim(struct dma_desc *desc)
+{
+	struct dma_desc *tmp, *next, *last = desc->lastAddr;
+
+	if (likely(!fw.wlan.rx_lend)) {
+		dma_reclaim(&fw.pta.down_queue, desc);
+		down_trigger();
+		return;
+	}
+
+	/* lend the freed blocks to the rx pool, one by one */
+	for (tmp = desc; ; tmp = next) {
+		next = tmp->nextAddr;
+		tmp->nextAddr = tmp->lastAddr = tmp;
+
+		if (fw.wlan.rx_lend) {
+			fw.wlan.rx_lend--;
+			fw.wlan.rx_lent++;
+			fw.stats.rx_balance.lent_blocks++;
+			fw.stats.rx_balance.max_lent = max(
+				fw.stats.rx_balance.max_lent, fw.wlan.rx_lent);
+			dma_reclaim(&fw.wlan.rx_queue, tmp);
+			wlan_trigger(AR9170_DMA_TRIGGER_RXQ);
+		} else {
+			dma_reclaim(&fw.pta.down_queue, tmp);
+			down_trigger();
+		}
+
+		if (tmp == last)
+			break;
+	}
+}
+
+void wlan_rx_reclaim(struct dma_desc *desc)
+{
+	struct dma_desc *tmp, *next, *last = desc->lastAddr;
+
+	if (likely(!fw.wlan.rx_return)) {
+		dma_reclaim(&fw.wlan.rx_queue, desc);
+		wlan_trigger(AR9170_DMA_TRIGGER_RXQ);
+		return;
+	}
+
+	/* hand the lent blocks back to the tx pool, one by one */
+	for (tmp = desc; ; tmp = next) {
+		next = tmp->nextAddr;
+		tmp->nextAddr = tmp->lastAddr = tmp;
+
+		if (fw.wlan.rx_return && is_tx_pool_desc(tmp)) {
+			fw.wlan.rx_return--;
+			fw.wlan.rx_lent--;
+			fw.stats.rx_balance.returned_blocks++;
+			dma_reclaim(&fw.pta.down_queue, tmp);
+			down_trigger();
+		} else {
+			dma_reclaim(&fw.wlan.rx_queue, tmp);
+			wlan_trigger(AR9170_DMA_TRIGGER_RXQ);
+		}
+
+		if (tmp == last)
+			break;
+	}
+}
+#endif /* CONFIG_CARL9170FW_RX_BALANCE */
+
 void handle_wlan_rx(void)
 {
 	struct dma_desc *desc;
+	unsigned int rx_class;
+#ifdef CONFIG_CARL9170FW_RX_TSF
+	uint32_t stamp[2], start = 0, now;
+	bool stamped = false;
+#endif /* CONFIG_CARL9170FW_RX_TSF */
 
 	for_each_desc_not_bits(desc, &fw.wlan.rx_queue, AR9170_OWN_BITS_HW) {
-		if (!(wlan_rx_filter(desc) & fw.wlan.rx_filter)) {
+#ifdef CONFIG_CARL9170FW_RX_TEST
+		if (unlikely(fw.wlan.rx_test)) {
+			wlan_rx_test(desc);
+			wlan_rx_reclaim(desc);
+			continue;
+		}
+#endif /* CONFIG_CARL9170FW_RX_TEST */
+
+		rx_class = wlan_rx_filter(desc);
+		if (!(rx_class & fw.wlan.rx_filter)) {
+#ifdef CONFIG_CARL9170FW_RX_DECAP
+			if (fw.wlan.rx_decap)
+				wlan_rx_decap(desc);
+#endif /* CONFIG_CARL9170FW_RX_DECAP */
+
+#ifdef CONFIG_CARL9170FW_RX_TSF
+			if (fw.wlan.rx_tsf) {
+				/* both words are in usec (TSF) or clock ticks */
+				if (fw.wlan.rx_tsf == CARL9170_RX_TSF_TSF)
+					now = get(AR9170_MAC_REG_TSF_L);
+				else
+					now = get_clock_counter();
+
+				/* one sample per run, plus a delta per frame */
+				if (!stamped) {
+					start = now;
+					stamped = true;
+				}
+
+				stamp[0] = cpu_to_le32(start);
+				stamp[1] = cpu_to_le32(now - start);
+				wlan_rx_stamp(desc, stamp);
+			}
+#endif /* CONFIG_CARL9170FW_RX_TSF */
+
+			wlan_rx_truncate(desc);
+			wlan_rx_filter_stats(rx_class, false, desc->totalLen);
+			fw.wlan.rx_up_pending++;
 			dma_put(&fw.pta.up_queue, desc);
 			up_trigger();
 		} else {
-			dma_reclaim(&fw.wlan.rx_queue, desc);
-			wlan_trigger(AR9170_DMA_TRIGGER_RXQ);
+			wlan_rx_filter_stats(rx_class, true, desc->totalLen);
+			wlan_rx_reclaim(desc);
 		}
 	}
 }
@@ -31,6 +31,7 @@
 #include "rf.h"
 #include "linux/ieee80211.h"
 #include "wol.h"
+#include "pgen.h"
 
 static void wlan_txunstuck(unsigned int qidx)
 {
@@ -165,27 +166,65 @@ void wlan_tx_complete(struct carl9170_tx_superframe *super,
 	status->success = (txs) ? 1 : 0;
 }
 
+#ifdef CONFIG_CARL9170FW_RATE_TABLE
+void wlan_set_rate_tbl(const struct carl9170_rate_tbl_cmd *cmd)
+{
+	memcpy(&dma_mem.reserved.rate_tbl.tbl[le32_to_cpu(cmd->idx) - 1],
+	       &cmd->phy, sizeof(struct carl9170_rate_tbl));
+}
+
+static const struct carl9170_rate_tbl *
+wlan_tx_rate_tbl(const struct carl9170_tx_superframe *super)
+{
+	const struct carl9170_rate_tbl *tbl;
+
+	if (likely(!super->s.rate_tbl))
+		return NULL;
+
+	tbl = &dma_mem.reserved.rate_tbl.tbl[super->s.rate_tbl - 1];
+	return tbl->ri[0].tries ? tbl : NULL;
+}
+#else
+static inline const struct carl9170_rate_tbl *
+wlan_tx_rate_tbl(const struct carl9170_tx_superframe *super __unused)
+{
+	return NULL;
+}
+#endif /* CONFIG_CARL9170FW_RATE_TABLE */
+
 static bool wlan_tx_consume_retry(struct carl9170_tx_superframe *super)
 {
+	const struct carl9170_rate_tbl *tbl = wlan_tx_rate_tbl(super);
+	const struct ar9170_tx_rate_info *ri = super->s.ri;
+	const struct ar9170_tx_hw_phy_control *rr = super->s.rr;
+	unsigned int ampdu = 1;
+
+	/* the station's current rates, read for every retry */
+	if (tbl) {
+		ri = tbl->ri;
+		rr = tbl->rr;
+		ampdu = super->s.ri[0].ampdu;
+	}
+
 	/* check if this was the last possible retry with this rate */
-	if (unlikely(super->s.cnt >= super->s.ri[super->s.rix].tries)) {
+	if (unlikely(super->s.cnt >= ri[super->s.rix].tries)) {
 		/* end of the road - indicate tx failure */
 		if (unlikely(super->s.rix == CARL9170_TX_MAX_RETRY_RATES))
 			return false;
 
 		/* check if there are alternative rates available */
-		if (!super->s.rr[super->s.rix].set)
+		if (!rr[super->s.rix].set)
 			return false;
 
 		/* try next retry rate */
-		super->f.hdr.phy.set = super->s.rr[super->s.rix].set;
+		super->f.hdr.phy.set = rr[super->s.rix].set;
 
 		/* finally - mark the old rate as USED */
 		super->s.rix++;
 
 		/* update MAC flags */
-		super->f.hdr.mac.erp_prot = super->s.ri[super->s.rix].erp_prot;
-		super->f.hdr.mac.ampdu = super->s.ri[super->s.rix].ampdu;
+		super->f.hdr.mac.erp_prot = ri[super->s.rix].erp_prot;
+		super->f.hdr.mac.ampdu = ri[super->s.rix].ampdu & ampdu;
 
 		/* reinitialize try counter */
 		super->s.cnt = 1;
@@ -197,6 +236,72 @@ static bool wlan_tx_consume_retry(struct carl9170_tx_superframe *super)
 	return true;
 }
 
+#ifdef CONFIG_CARL9170FW_ADAPTIVE_PROTECTION
+/*
+ * The decision is based on the first attempts only. These are always
+ * sent the way the application wanted, so the protection which is
+ * added to the retries does not skew the measurement.
+ */
+static void wlan_tx_prot_update(struct carl9170_tx_superframe *super,
+				const unsigned int qidx, const bool fail)
+{
+	struct carl9170_prot_stats *stats = &fw.stats.prot[qidx];
+	unsigned int enable;
+
+	/* BlockAck failures don't tell much about the medium */
+	if (super->f.hdr.mac.ampdu)
+		return;
+
+	if (super->s.rix || super->s.cnt > 1) {
+		if (super->f.hdr.mac.erp_prot) {
+			stats->prot_tries++;
+			stats->prot_failures += fail;
+		} else {
+			stats->tries++;
+			stats->failures += fail;
+		}
+		return;
+	}
+
+	fw.wlan.prot_failures[qidx] += fail;
+	if (++fw.wlan.prot_samples[qidx] < CARL9170_PROT_WINDOW)
+		return;
+
+	enable = fw.wlan.prot_enabled & BIT(qidx);
+	if (fw.wlan.prot_failures[qidx] >= CARL9170_PROT_ON_THRESHOLD)
+		enable = BIT(qidx);
+	else if (fw.wlan.prot_failures[qidx] <= CARL9170_PROT_OFF_THRESHOLD)
+		enable = 0;
+
+	if (enable != (fw.wlan.prot_enabled & BIT(qidx))) {
+		fw.wlan.prot_enabled ^= BIT(qidx);
+		stats->toggles++;
+	}
+
+	fw.wlan.prot_samples[qidx] = 0;
+	fw.wlan.prot_failures[qidx] = 0;
+}
+
+static void wlan_tx_prot_retry(struct carl9170_tx_superframe *super,
+			       const unsigned int qidx)
+{
+	if ((fw.wlan.prot_enabled & BIT(qidx)) &&
+	    !super->f.hdr.mac.ampdu && !super->f.hdr.mac.erp_prot)
+		super->f.hdr.mac.erp_prot = AR9170_TX_MAC_PROT_RTS;
+}
+#else
+static inline void wlan_tx_prot_update(struct carl9170_tx_superframe __unused *super,
+				       const unsigned int __unused qidx,
+				       const bool __unused fail)
+{
+}
+
+static inline void wlan_tx_prot_retry(struct carl9170_tx_superframe __unused *super,
+				      const unsigned int __unused qidx)
+{
+}
+#endif /* CONFIG_CARL9170FW_ADAPTIVE_PROTECTION */
+
 static inline u16 get_tid(struct ieee80211_hdr *hdr)
 {
 	return (ieee80211_get_qos_ctl(hdr))[0] & IEEE80211_QOS_CTL_TID_MASK;
@@ -295,14 +400,68 @@ static void wlan_assign_seq(struct ieee80211_hdr *hdr, unsigned int vif)
 		fw.wlan.sequence[vif] += 0x10;
 }
 
+#ifdef CONFIG_CARL9170FW_TXOP_BURST
+void wlan_set_txop(const struct carl9170_txop_cmd *cmd)
+{
+	unsigned int ac;
+
+	for (ac = 0; ac < __AR9170_NUM_TXQ; ac++) {
+		fw.wlan.txop_frames[ac] = cmd->frames[ac];
+		fw.wlan.txop_burst[ac] = 0;
+	}
+}
+
+/*
+ * The MAC keeps sending the frames of a queue within the TXOP,
+ * until it runs out of time or frames. A frame with disable_txop
+ * set ends the burst, the next one has to contend again. The
+ * budget only counts frames, the MAC decides when a TXOP starts.
+ */
+static void wlan_txop_burst(struct carl9170_tx_superframe *super)
+{
+	const unsigned int ac = super->s.queue;
+
+	if (ac >= __AR9170_NUM_TXQ || !fw.wlan.txop_frames[ac])
+		return;
+
+	/* an idle queue contends for a new TXOP anyway */
+	if (queue_empty(&fw.wlan.tx_queue[ac]) ||
+	    fw.wlan.txop_burst[ac] >= fw.wlan.txop_frames[ac]) {
+		fw.wlan.txop_burst[ac] = 0;
+		fw.stats.txop.budgets[ac]++;
+	}
+
+	fw.wlan.txop_burst[ac]++;
+	fw.stats.txop.frames[ac]++;
+
+	/* never clears the host's own disable_txop */
+	if (fw.wlan.txop_burst[ac] == fw.wlan.txop_frames[ac])
+		super->f.hdr.mac.disable_txop = 1;
+}
+#else
+static inline void wlan_txop_burst(struct carl9170_tx_superframe __unused *super)
+{
+}
+#endif /* CONFIG_CARL9170FW_TXOP_BURST */
+
 /* prepares frame for the first transmission */
 static void _wlan_tx(struct dma_desc *desc)
 {
 	struct carl9170_tx_superframe *super = get_super(desc);
+	const struct carl9170_rate_tbl *tbl = wlan_tx_rate_tbl(super);
+
+	/* the table may have changed, while the frame was queued */
+	if (tbl) {
+		super->f.hdr.phy.set = tbl->phy.set;
+		super->f.hdr.mac.erp_prot = tbl->ri[0].erp_prot;
+		super->f.hdr.mac.ampdu = tbl->ri[0].ampdu & super->s.ri[0].ampdu;
+	}
 
 	if (unlikely(super->s.assign_seq))
 		wlan_assign_seq(&super->f.data.i3e, super->s.vif_id);
 
+	wlan_txop_burst(super);
+
 	if (unlikely(super->s.ampdu_commit_density)) {
 		set(AR9170_MAC_REG_AMPDU_DENSITY,
 		    MOD_VAL(AR9170_MAC_AMPDU_DENSITY,
@@ -318,6 +477,451 @@ static void _wlan_tx(struct dma_desc *desc)
 	}
 }
 
+#ifdef CONFIG_CARL9170FW_PS_POLL_OFFLOAD
+static bool wlan_ps_hold(struct dma_desc *desc,
+			 struct carl9170_tx_superframe *super)
+{
+	const unsigned int sta = super->s.ps_sta - 1;
+
+	/* the station is awake (again), send the frame right away */
+	if (sta >= CARL9170_PS_STA_NUM || !fw.wlan.ps_aid[sta])
+		return false;
+
+	fw.wlan.ps_queue_len[sta][super->s.queue]++;
+	fw.stats.ps[sta].held++;
+	dma_put(&fw.wlan.ps_queue[sta][super->s.queue], desc);
+	return true;
+}
+
+static unsigned int wlan_ps_queued(const unsigned int sta,
+				   const unsigned int acs)
+{
+	unsigned int ac, queued = 0;
+
+	for (ac = 0; ac < __AR9170_NUM_TXQ; ac++) {
+		if (acs & BIT(ac))
+			queued += fw.wlan.ps_queue_len[sta][ac];
+	}
+
+	return queued;
+}
+
+/* highest priority AC with a held frame */
+static unsigned int wlan_ps_next_ac(const unsigned int sta,
+				    const unsigned int acs)
+{
+	unsigned int ac;
+
+	for (ac = __AR9170_NUM_TXQ; ac-- > 0; ) {
+		if ((acs & BIT(ac)) && fw.wlan.ps_queue_len[sta][ac])
+			break;
+	}
+
+	return ac;
+}
+
+static struct carl9170_tx_superframe *
+wlan_ps_send(const unsigned int sta, const unsigned int ac,
+	     const bool more, const bool eosp)
+{
+	struct carl9170_tx_superframe *super;
+	struct dma_desc *desc;
+
+	desc = dma_unlink_head(&fw.wlan.ps_queue[sta][ac]);
+	fw.wlan.ps_queue_len[sta][ac]--;
+
+	/* see: 802.11-2007 11.2.1.5 c) and 11.2.1.4 */
+	super = get_super(desc);
+	if (more) {
+		super->f.data.i3e.frame_control |=
+			cpu_to_le16(IEEE80211_FCTL_MOREDATA);
+	} else {
+		super->f.data.i3e.frame_control &=
+			cpu_to_le16(~IEEE80211_FCTL_MOREDATA);
+	}
+
+	if (eosp && ieee80211_is_data_qos(super->f.data.i3e.frame_control))
+		ieee80211_get_qos_ctl(&super->f.data.i3e)[0] |= IEEE80211_QOS_CTL_EOSP;
+
+	_wlan_tx(desc);
+	__wlan_tx(desc);
+	wlan_trigger(BIT(super->s.queue));
+	return super;
+}
+
+bool wlan_ps_poll(const unsigned int sta)
+{
+	unsigned int acs, ac;
+
+	/* PS-Polls are for the legacy ACs, unless all are delivery-enabled */
+	acs = ~fw.wlan.ps_uapsd[sta] & CARL9170_PS_AC_MASK;
+	if (!acs)
+		acs = CARL9170_PS_AC_MASK;
+
+	ac = wlan_ps_next_ac(sta, acs);
+	if (ac >= __AR9170_NUM_TXQ)
+		return false;
+
+	wlan_ps_send(sta, ac, wlan_ps_queued(sta, acs) > 1, false);
+	return true;
+}
+
+bool wlan_ps_trigger(const unsigned int sta, const unsigned int ac)
+{
+	const unsigned int acs = fw.wlan.ps_uapsd[sta];
+	struct carl9170_ps_stats *stats = &fw.stats.ps[sta];
+	unsigned int queued, count, i;
+
+	/* not a trigger-enabled AC, or the service period is still running */
+	if (!(acs & BIT(ac)) || (fw.wlan.ps_sp & BIT(sta)))
+		return false;
+
+	queued = wlan_ps_queued(sta, acs);
+	if (!queued) {
+		/* the application has to end the SP with a QoS Null */
+		stats->empty_triggers++;
+		return false;
+	}
+
+	count = queued;
+	if (fw.wlan.ps_max_sp[sta])
+		count = min(count, fw.wlan.ps_max_sp[sta]);
+
+	for (i = 1; i <= count; i++) {
+		fw.wlan.ps_sp_end[sta] = wlan_ps_send(sta,
+			wlan_ps_next_ac(sta, acs),
+			i < count || queued > count, i == count);
+	}
+
+	fw.wlan.ps_sp |= BIT(sta);
+	stats->service_periods++;
+	stats->sp_frames += count;
+	return true;
+}
+
+void wlan_ps_set_sta(const unsigned int sta,
+		     const struct carl9170_ps_sta_cmd *cmd)
+{
+	unsigned int ac;
+
+	fw.wlan.ps_aid[sta] = le32_to_cpu(cmd->aid) & 0x3fff;
+	fw.wlan.ps_uapsd[sta] = le32_to_cpu(cmd->uapsd) & CARL9170_PS_AC_MASK;
+	fw.wlan.ps_max_sp[sta] = le32_to_cpu(cmd->max_sp);
+	memcpy(fw.wlan.ps_addr[sta], cmd->addr, sizeof(cmd->addr));
+	fw.wlan.ps_pending &= ~BIT(sta);
+	fw.wlan.ps_sp &= ~BIT(sta);
+
+	if (fw.wlan.ps_aid[sta])
+		return;
+
+	/* the station woke up, or it is gone. */
+	for (ac = 0; ac < __AR9170_NUM_TXQ; ac++) {
+		while (fw.wlan.ps_queue_len[sta][ac])
+			wlan_ps_send(sta, ac, false, false);
+	}
+}
+
+static void wlan_ps_tx_done(struct carl9170_tx_superframe *super)
+{
+	const unsigned int sta = super->s.ps_sta - 1;
+	struct carl9170_ps_stats *stats;
+
+	if (likely(sta >= CARL9170_PS_STA_NUM))
+		return;
+
+	if (!(fw.wlan.ps_pending & BIT(sta)))
+		return;
+
+	stats = &fw.stats.ps[sta];
+	stats->latency = (fw.tally_clock - fw.wlan.ps_poll_time[sta]) /
+			 fw.ticks_per_usec;
+	stats->max_latency = max(stats->max_latency, stats->latency);
+	fw.wlan.ps_pending &= ~BIT(sta);
+}
+
+/*
+ * The SP is over once its last frame is done (acked or out of
+ * retries). This frame is not always QoS data with the EOSP bit.
+ */
+static void wlan_ps_tx_complete(struct carl9170_tx_superframe *super)
+{
+	const unsigned int sta = super->s.ps_sta - 1;
+
+	if (likely(sta >= CARL9170_PS_STA_NUM))
+		return;
+
+	if (fw.wlan.ps_sp_end[sta] == super)
+		fw.wlan.ps_sp &= ~BIT(sta);
+}
+#else
+static inline bool wlan_ps_hold(struct dma_desc __unused *desc,
+				struct carl9170_tx_superframe __unused *super)
+{
+	return false;
+}
+
+static inline void wlan_ps_tx_done(struct carl9170_tx_superframe __unused *super)
+{
+}
+
+static inline void wlan_ps_tx_complete(struct carl9170_tx_superframe __unused *super)
+{
+}
+#endif /* CONFIG_CARL9170FW_PS_POLL_OFFLOAD */
+
+#ifdef CONFIG_CARL9170FW_TX_AMSDU
+/*
+ * Small QoS data frames for the same RA and TID, which come in
+ * with the same download burst, are merged into one A-MSDU. The
+ * first frame becomes the MPDU, the blocks of the others are
+ * chained to it. The cookies of the absorbed frames are kept in
+ * the tail of the first block, the last byte is their number.
+ * Only frames, whose sequence number the firmware assigns, are
+ * merged. The A-MSDU takes one, so no host assigned one is lost.
+ */
+#define CARL9170_TX_AMSDU_SUBHDR_LEN	14
+
+static inline uint8_t *wlan_tx_amsdu_tail(struct carl9170_tx_superframe *super)
+{
+	return (uint8_t *) super + AR9170_BLOCK_SIZE - CARL9170_TX_AMSDU_MAX_FRAMES;
+}
+
+void wlan_set_amsdu_sta(const unsigned int sta,
+			const struct carl9170_amsdu_sta_cmd *cmd)
+{
+	fw.wlan.amsdu_max_len[sta] = min(le32_to_cpu(cmd->max_len),
+					 (uint32_t) IEEE80211_MAX_MPDU_LEN_HT_7935);
+	memcpy(fw.wlan.amsdu_addr[sta], cmd->addr, sizeof(cmd->addr));
+}
+
+static int wlan_tx_amsdu_slot(struct dma_desc *desc)
+{
+	struct carl9170_tx_superframe *super = DESC_PAYLOAD(desc);
+	struct ieee80211_hdr *hdr = &super->f.data.i3e;
+	const __le16 fc = hdr->frame_control;
+	unsigned int i;
+
+	/* plain single block frames, which are sent right away */
+	if (desc->lastAddr != desc ||
+	    le16_to_cpu(super->s.len) > CARL9170_TX_AMSDU_FRAME_LEN ||
+	    !super->s.assign_seq || super->s.cab || super->s.ps_sta ||
+	    super->s.fill_in_tsf || super->f.hdr.mac.ampdu ||
+	    super->f.hdr.mac.enc_mode)
+		return -1;
+
+	if (!ieee80211_is_data_qos(fc) || ieee80211_has_protected(fc) ||
+	    ieee80211_has_a4(fc) || ieee80211_has_morefrags(fc) ||
+	    ieee80211_has_order(fc) ||
+	    (hdr->seq_ctrl & cpu_to_le16(IEEE80211_SCTL_FRAG)) ||
+	    (ieee80211_get_qos_ctl(hdr)[0] & IEEE80211_QOS_CTL_A_MSDU_PRESENT))
+		return -1;
+
+	for (i = 0; i < CARL9170_AMSDU_STA_NUM; i++) {
+		if (fw.wlan.amsdu_max_len[i] &&
+		    compare_ether_address(hdr->addr1, fw.wlan.amsdu_addr[i]))
+			return i;
+	}
+
+	return -1;
+}
+
+static uint8_t *wlan_tx_msdu(struct carl9170_tx_superframe *super,
+			     unsigned int *len)
+{
+	const unsigned int hdrlen = ieee80211_hdrlen(super->f.data.i3e.frame_control);
+
+	*len = le16_to_cpu(super->s.len) - hdrlen -
+	       sizeof(struct carl9170_tx_superdesc) -
+	       sizeof(struct ar9170_tx_hwdesc);
+	return super->f.data.payload + hdrlen;
+}
+
+/* puts the subframe header in front of the MSDU, which moves to dst */
+static unsigned int wlan_tx_amsdu_subframe(uint8_t *dst, struct ieee80211_hdr *hdr,
+					   const uint8_t *msdu, const unsigned int len)
+{
+	uint8_t sub[CARL9170_TX_AMSDU_SUBHDR_LEN];
+
+	memcpy(sub, ieee80211_get_DA(hdr), 6);
+	memcpy(sub + 6, ieee80211_get_SA(hdr), 6);
+	sub[12] = len >> 8;
+	sub[13] = len & 0xff;
+
+	memmove(dst + sizeof(sub), msdu, len);
+	memcpy(dst, sub, sizeof(sub));
+	return sizeof(sub) + len;
+}
+
+static void wlan_tx_amsdu_grow(struct dma_desc *desc, const unsigned int grow)
+{
+	struct carl9170_tx_superframe *super = DESC_PAYLOAD(desc);
+
+	super->s.len = cpu_to_le16(le16_to_cpu(super->s.len) + grow);
+	super->f.hdr.length = cpu_to_le16(le16_to_cpu(super->f.hdr.length) + grow);
+	desc->totalLen += grow;
+	fw.wlan.amsdu_len += grow;
+}
+
+static void wlan_tx_amsdu_start(struct dma_desc *desc)
+{
+	struct carl9170_tx_superframe *super = DESC_PAYLOAD(desc);
+	struct ieee80211_hdr *hdr = &super->f.data.i3e;
+	unsigned int len;
+	uint8_t *msdu;
+
+	/* the subframe header, padding and cookies fit into the first block */
+	BUILD_BUG_ON(CARL9170_TX_AMSDU_FRAME_LEN + CARL9170_TX_AMSDU_SUBHDR_LEN + 3 >
+		     AR9170_BLOCK_SIZE - CARL9170_TX_AMSDU_MAX_FRAMES);
+
+	msdu = wlan_tx_msdu(super, &len);
+	fw.wlan.amsdu_len = len;
+	desc->totalLen = desc->dataSize = le16_to_cpu(super->s.len);
+
+	wlan_tx_amsdu_subframe(msdu, hdr, msdu, len);
+	desc->dataSize += CARL9170_TX_AMSDU_SUBHDR_LEN;
+	wlan_tx_amsdu_grow(desc, CARL9170_TX_AMSDU_SUBHDR_LEN);
+
+	/* the MPDU's addr3 is the BSSID */
+	if (ieee80211_has_fromds(hdr->frame_control))
+		memcpy(hdr->addr3, hdr->addr2, 6);
+	else if (ieee80211_has_tods(hdr->frame_control))
+		memcpy(hdr->addr3, hdr->addr1, 6);
+
+	ieee80211_get_qos_ctl(hdr)[0] |= IEEE80211_QOS_CTL_A_MSDU_PRESENT;
+	super->s.amsdu = 1;
+	wlan_tx_amsdu_tail(super)[CARL9170_TX_AMSDU_MAX_FRAMES - 1] = 0;
+	fw.stats.tx_amsdu.merged++;
+}
+
+static bool wlan_tx_amsdu_fits(struct dma_desc *head, struct dma_desc *desc)
+{
+	struct carl9170_tx_superframe *first = DESC_PAYLOAD(head);
+	struct carl9170_tx_superframe *super = DESC_PAYLOAD(desc);
+	unsigned int len, total;
+
+	if (first->s.amsdu &&
+	    wlan_tx_amsdu_tail(first)[CARL9170_TX_AMSDU_MAX_FRAMES - 1] ==
+	    CARL9170_TX_AMSDU_MAX_FRAMES - 1)
+		return false;
+
+	if (super->s.queue != first->s.queue ||
+	    super->s.vif_id != first->s.vif_id ||
+	    memcmp(super->f.data.i3e.addr2, first->f.data.i3e.addr2, 6) ||
+	    *ieee80211_get_qos_ctl(&super->f.data.i3e) !=
+	    (*ieee80211_get_qos_ctl(&first->f.data.i3e) &
+	     ~IEEE80211_QOS_CTL_A_MSDU_PRESENT))
+		return false;
+
+	wlan_tx_msdu(super, &len);
+	if (first->s.amsdu) {
+		total = fw.wlan.amsdu_len;
+	} else {
+		wlan_tx_msdu(first, &total);
+		total += CARL9170_TX_AMSDU_SUBHDR_LEN;
+	}
+
+	total = ALIGN(total, 4) + CARL9170_TX_AMSDU_SUBHDR_LEN + len;
+	return total <= fw.wlan.amsdu_max_len[fw.wlan.amsdu_sta];
+}
+
+static void wlan_tx_amsdu_append(struct dma_desc *head, struct dma_desc *desc)
+{
+	struct carl9170_tx_superframe *first = DESC_PAYLOAD(head);
+	struct carl9170_tx_superframe *super = DESC_PAYLOAD(desc);
+	struct dma_desc *last = head->lastAddr;
+	unsigned int len, pad, hdrlen;
+	uint8_t *msdu, *tail;
+	uint8_t cookie;
+
+	/* the previous subframe is padded to a multiple of four bytes */
+	pad = ALIGN(fw.wlan.amsdu_len, 4) - fw.wlan.amsdu_len;
+	memset(DESC_PAYLOAD_OFF(last, last->dataSize), 0, pad);
+	last->dataSize += pad;
+	last->ctrl &= ~AR9170_CTRL_LS_BIT;
+
+	cookie = super->s.cookie;
+	hdrlen = ieee80211_hdrlen(super->f.data.i3e.frame_control);
+	msdu = wlan_tx_msdu(super, &len);
+	len = wlan_tx_amsdu_subframe((uint8_t *) super, &super->f.data.i3e,
+				     msdu, len);
+	desc->totalLen = desc->dataSize = len;
+	desc->ctrl = (desc->ctrl & ~AR9170_CTRL_FS_BIT) | AR9170_CTRL_LS_BIT;
+
+	last->nextAddr = desc;
+	head->lastAddr = desc;
+	wlan_tx_amsdu_grow(head, pad + len);
+
+	tail = wlan_tx_amsdu_tail(first);
+	tail[tail[CARL9170_TX_AMSDU_MAX_FRAMES - 1]++] = cookie;
+
+	fw.stats.tx_amsdu.absorbed++;
+	fw.stats.tx_amsdu.saved_bytes += hdrlen + FCS_LEN -
+		CARL9170_TX_AMSDU_SUBHDR_LEN - pad;
+}
+
+void wlan_tx_amsdu_flush(void)
+{
+	if (!fw.wlan.amsdu_pending)
+		return;
+
+	wlan_tx(fw.wlan.amsdu_pending);
+	fw.wlan.amsdu_pending = NULL;
+}
+
+void wlan_tx_amsdu(struct dma_desc *desc)
+{
+	struct dma_desc *head = fw.wlan.amsdu_pending;
+	struct carl9170_tx_superframe *super = DESC_PAYLOAD(desc);
+	int sta;
+
+	/* only the firmware merges frames */
+	super->s.amsdu = 0;
+	sta = wlan_tx_amsdu_slot(desc);
+
+	if (head) {
+		if (sta == (int) fw.wlan.amsdu_sta &&
+		    wlan_tx_amsdu_fits(head, desc)) {
+			if (!((struct carl9170_tx_superframe *) DESC_PAYLOAD(head))->s.amsdu)
+				wlan_tx_amsdu_start(head);
+
+			wlan_tx_amsdu_append(head, desc);
+			return;
+		}
+
+		wlan_tx_amsdu_flush();
+	}
+
+	if (sta < 0) {
+		wlan_tx(desc);
+		return;
+	}
+
+	/* wait for the next frame of the burst */
+	fw.wlan.amsdu_pending = desc;
+	fw.wlan.amsdu_sta = sta;
+}
+
+static void wlan_tx_amsdu_done(struct carl9170_tx_superframe *super,
+			       const bool success)
+{
+	uint8_t *tail = wlan_tx_amsdu_tail(super);
+	unsigned int i;
+
+	if (likely(!super->s.amsdu))
+		return;
+
+	for (i = 0; i < tail[CARL9170_TX_AMSDU_MAX_FRAMES - 1]; i++) {
+		super->s.cookie = tail[i];
+		wlan_tx_complete(super, success);
+	}
+}
+#else
+static inline void wlan_tx_amsdu_done(struct carl9170_tx_superframe __unused *super,
+				      const bool __unused success)
+{
+}
+#endif /* CONFIG_CARL9170FW_TX_AMSDU */
+
 /* propagate transmission status back to the driver */
 static bool wlan_tx_status(struct dma_queue *queue,
 			   struct dma_desc *desc)
@@ -326,10 +930,27 @@ static bool wlan_tx_status(struct dma_queue *queue,
 	unsigned int qidx = super->s.queue;
 	bool txfail = false, success;
 
+	if (unlikely(pgen_is_frame(super))) {
+		txfail = !!(desc->ctrl & AR9170_CTRL_TXFAIL);
+
+		wlan_tx_progress(qidx);
+		dma_unlink_head(queue);
+		pgen_tx_done(desc, !txfail);
+
+		/* generated frames are never retried */
+		if (txfail)
+			wlan_txunstuck(qidx);
+
+		return !txfail;
+	}
+
+	wlan_ps_tx_done(super);
+
 	success = true;
 
-	/* update hangcheck */
-	fw.wlan.last_super_num[qidx] = 0;
+	wlan_tx_progress(qidx);
+
+	wlan_tx_prot_update(super, qidx, !!(desc->ctrl & AR9170_CTRL_TXFAIL));
 
 	/*
 	 * Note:
@@ -375,6 +996,7 @@ static bool wlan_tx_status(struct dma_queue *queue,
 
 			if (txfail) {
 				/* Normal TX Failure */
+				wlan_tx_prot_retry(super, qidx);
 
 				/* demise descriptor ownership back to the hardware */
 				dma_rearm(desc);
@@ -438,18 +1060,31 @@ static bool wlan_tx_status(struct dma_queue *queue,
 		goto out;
 	}
 
-	if (unlikely(super->s.cab))
-		fw.wlan.cab_queue_len[super->s.vif_id]--;
+	if (unlikely(super->s.cab)) {
+		const unsigned int vif = super->s.vif_id;
+
+		if (--fw.wlan.cab_queue_len[vif] == 0 &&
+		    fw.wlan.cab_flush_trigger[vif] == CARL9170_CAB_TRIGGER_DEFER) {
+			struct carl9170_cab_stats *stats = &fw.stats.cab[vif];
 
+			/* all buffered traffic for this DTIM is out */
+			stats->latency = (get_clock_counter() -
+				fw.wlan.cab_flush_time[vif]) / fw.ticks_per_usec;
+			stats->max_latency = max(stats->max_latency,
+						 stats->latency);
+		}
+	}
+
+	wlan_ps_tx_complete(super);
 	wlan_tx_complete(super, success);
+	wlan_tx_amsdu_done(super, success);
 
 	if (ieee80211_is_back_req(super->f.data.i3e.frame_control)) {
 		fw.wlan.queued_bar--;
 	}
 
 	/* recycle freed descriptors */
-	dma_reclaim(&fw.pta.down_queue, desc);
-	down_trigger();
+	wlan_tx_reclaim(desc);
 out:
 	/*
 	 * if we encounter a frame which run out of (normal)
@@ -496,11 +1131,18 @@ void __hot wlan_tx(struct dma_desc *desc)
 	hide_super(desc);
 
 	if (unlikely(super->s.cab)) {
+		if (fw.wlan.cab_flush_trigger[super->s.vif_id] &
+		    CARL9170_CAB_TRIGGER_DEFER)
+			fw.stats.cab[super->s.vif_id].deferred++;
+
 		fw.wlan.cab_queue_len[super->s.vif_id]++;
 		dma_put(&fw.wlan.cab_queue[super->s.vif_id], desc);
 		return;
 	}
 
+	if (unlikely(super->s.ps_sta) && wlan_ps_hold(desc, super))
+		return;
+
 	_wlan_tx(desc);
 	__wlan_tx(desc);
 	wlan_trigger(BIT(super->s.queue));
@@ -607,6 +1249,8 @@ void wlan_cab_flush_queue(const unsigned int vif)
 				cpu_to_le16(~IEEE80211_FCTL_MOREDATA);
 		}
 
+		fw.stats.cab[vif].sent++;
+
 		/* ready to roll! */
 		_wlan_tx(desc);
 		__wlan_tx(desc);
@@ -635,31 +1279,40 @@ static uint8_t *beacon_find_ie(uint8_t ie, void *addr,
 	return NULL;
 }
 
+static void wlan_beacon_update_tim(const unsigned int vif,
+				   struct ieee80211_tim_ie *ie)
+{
+	if (!queue_empty(&fw.wlan.cab_queue[vif]) && (ie->dtim_count == 0)) {
+		/*
+		 * schedule DTIM transfer.
+		 * The deadline is relative to the PRETBTT event
+		 * of this vif's beacon.
+		 */
+		fw.wlan.cab_flush_trigger[vif] = CARL9170_CAB_TRIGGER_ARMED;
+		fw.wlan.cab_flush_time[vif] = fw.wlan.pretbtt_time;
+		fw.wlan.cab_armed |= BIT(vif);
+	} else if ((fw.wlan.cab_queue_len[vif] == 0) && (fw.wlan.cab_flush_trigger[vif])) {
+		/* undo all chances to the beacon structure */
+		ie->bitmap_ctrl &= ~0x1;
+		fw.wlan.cab_flush_trigger[vif] = CARL9170_CAB_TRIGGER_EMPTY;
+		fw.wlan.cab_armed &= ~BIT(vif);
+	}
+
+	/* Triggered by CARL9170_CAB_TRIGGER_ARMED || CARL9170_CAB_TRIGGER_DEFER */
+	if (fw.wlan.cab_flush_trigger[vif]) {
+		/* Set the almighty Multicast Traffic Indication Bit. */
+		ie->bitmap_ctrl |= 0x1;
+	}
+}
+
 void wlan_modify_beacon(const unsigned int vif,
 	const unsigned int addr, const unsigned int len)
 {
 	uint8_t *_ie;
-	struct ieee80211_tim_ie *ie;
 
 	_ie = beacon_find_ie(WLAN_EID_TIM, (void *)addr, len);
-	if (likely(_ie)) {
-		ie = (struct ieee80211_tim_ie *) &_ie[2];
-
-		if (!queue_empty(&fw.wlan.cab_queue[vif]) && (ie->dtim_count == 0)) {
-			/* schedule DTIM transfer */
-			fw.wlan.cab_flush_trigger[vif] = CARL9170_CAB_TRIGGER_ARMED;
-		} else if ((fw.wlan.cab_queue_len[vif] == 0) && (fw.wlan.cab_flush_trigger[vif])) {
-			/* undo all chances to the beacon structure */
-			ie->bitmap_ctrl &= ~0x1;
-			fw.wlan.cab_flush_trigger[vif] = CARL9170_CAB_TRIGGER_EMPTY;
-		}
-
-		/* Triggered by CARL9170_CAB_TRIGGER_ARMED || CARL9170_CAB_TRIGGER_DEFER */
-		if (fw.wlan.cab_flush_trigger[vif]) {
-			/* Set the almighty Multicast Traffic Indication Bit. */
-			ie->bitmap_ctrl |= 0x1;
-		}
-	}
+	if (likely(_ie))
+		wlan_beacon_update_tim(vif, (struct ieee80211_tim_ie *) &_ie[2]);
 
 	/*
 	 * Ideally, the sequence number should be assigned by the TX arbiter
@@ -671,34 +1324,261 @@ void wlan_modify_beacon(const unsigned int vif,
 	wlan_assign_seq((struct ieee80211_hdr *)addr, vif);
 }
 
-void wlan_send_buffered_cab(void)
+static void wlan_arm_beacon(const unsigned int addr, const unsigned int len)
 {
-	unsigned int i;
+	set(AR9170_MAC_REG_BCN_ADDR, addr);
+	set(AR9170_MAC_REG_BCN_LENGTH, len);
+	set(AR9170_MAC_REG_BCN_CTRL, AR9170_BCN_CTRL_READY);
+}
+
+void wlan_set_beacon_template(const unsigned int vif,
+	const unsigned int addr, const unsigned int len)
+{
+	unsigned int start = (unsigned int) &dma_mem.reserved.bcn.buf[vif];
+
+	/*
+	 * The template is modified in place on every PRETBTT event.
+	 * Therefore it has to stay within the vif's beacon buffer.
+	 */
+	if (unlikely(addr < start ||
+	    addr + len > start + sizeof(dma_mem.reserved.bcn.buf[vif]) ||
+	    len < (sizeof(struct ieee80211_hdr_3addr) + 12 + FCS_LEN)))
+		return;
+
+	fw.wlan.bcn_tmpl_addr[vif] = addr;
+	fw.wlan.bcn_tmpl_len[vif] = len;
+
+	/*
+	 * The application has already filled in the DTIM count for
+	 * the next beacon. Don't advance it on the upcoming PRETBTT.
+	 */
+	fw.wlan.bcn_tmpl_fresh |= BIT(vif);
+}
+
+void wlan_send_beacon_template(void)
+{
+	struct ieee80211_tim_ie *ie;
+	unsigned int i, vif, addr, len;
+	uint8_t *_ie;
 
+	/*
+	 * The MAC has just a single beacon slot. If more than one
+	 * interface is beaconing, the slot is handed out in a
+	 * round-robin fashion, just like the driver does it.
+	 */
 	for (i = 0; i < CARL9170_INTF_NUM; i++) {
-		if (unlikely(fw.wlan.cab_flush_trigger[i] == CARL9170_CAB_TRIGGER_ARMED)) {
-			/*
-			 * This is hardcoded into carl9170usb driver.
-			 *
-			 * The driver must set the PRETBTT event to beacon_interval -
-			 * CARL9170_PRETBTT_KUS (usually 6) Kus.
-			 *
-			 * But still, we can only do so much about 802.11-2007 9.3.2.1 &
-			 * 11.2.1.6. Let's hope the current solution is adequate enough.
-			 */
+		vif = (fw.wlan.bcn_tmpl_next + i) % CARL9170_INTF_NUM;
+		if (fw.wlan.bcn_tmpl_len[vif])
+			break;
+	}
 
-			if (is_after_msecs(fw.wlan.cab_flush_time, (CARL9170_TBTT_DELTA))) {
-				wlan_cab_flush_queue(i);
+	if (likely(i == CARL9170_INTF_NUM))
+		return;
 
-				/*
-				 * This prevents the code from sending new BC/MC frames
-				 * which were queued after the previous buffered traffic
-				 * has been sent out... They will have to wait until the
-				 * next DTIM beacon comes along.
-				 */
-				fw.wlan.cab_flush_trigger[i] = CARL9170_CAB_TRIGGER_DEFER;
-			}
-		}
+	fw.wlan.bcn_tmpl_next = vif + 1;
+	addr = fw.wlan.bcn_tmpl_addr[vif];
+	len = fw.wlan.bcn_tmpl_len[vif];
+
+	_ie = beacon_find_ie(WLAN_EID_TIM, (void *)addr, len);
+	if (unlikely(!_ie || _ie[1] < 4)) {
+		/*
+		 * Without a TIM the firmware has nothing to maintain.
+		 * Hand the beacon back to the application.
+		 */
+		fw.wlan.bcn_tmpl_len[vif] = 0;
+		send_cmd_to_host(0, CARL9170_RSP_BEACON_TEMPLATE, vif, NULL);
+		return;
+	}
+
+	ie = (struct ieee80211_tim_ie *) &_ie[2];
+	if (fw.wlan.bcn_tmpl_fresh & BIT(vif)) {
+		fw.wlan.bcn_tmpl_fresh &= ~BIT(vif);
+	} else if (ie->dtim_count == 0) {
+		/* 802.11-2007 7.3.2.6: counts down to 0, the DTIM */
+		if (ie->dtim_period > 1)
+			ie->dtim_count = ie->dtim_period - 1;
+	} else {
+		ie->dtim_count--;
+	}
+
+	wlan_beacon_update_tim(vif, ie);
+	wlan_assign_seq((struct ieee80211_hdr *)addr, vif);
+	wlan_arm_beacon(addr, len);
+}
+
+#ifdef CONFIG_CARL9170FW_PROBE_RESP_OFFLOAD
+void wlan_set_probe_resp(const unsigned int vif, const unsigned int flags,
+			 struct carl9170_rsp *resp)
+{
+	struct carl9170_tx_superframe *super = wlan_probe_resp_tmpl(vif);
+	const unsigned int len = le16_to_cpu(super->s.len);
+
+	fw.wlan.probe_ssid[vif] = NULL;
+
+	if ((flags & CARL9170_PROBE_RESP_ENABLE) &&
+	    ar9170_tx_length_check(len) &&
+	    len <= CARL9170_PROBE_RESP_BUFFER_LEN &&
+	    ieee80211_is_probe_resp(super->f.data.i3e.frame_control)) {
+		/* the firmware takes care of these, for every response */
+		super->s.cab = 0;
+		super->s.ps_sta = 0;
+		super->s.fill_in_tsf = 1;
+		super->f.hdr.mac.ampdu = 0;
+		fw.wlan.probe_phy[vif] = super->f.hdr.phy.set;
+
+		fw.wlan.probe_ssid[vif] = beacon_find_ie(WLAN_EID_SSID,
+			&super->f.data.i3e, le16_to_cpu(super->f.hdr.length));
+	}
+
+	resp->hdr.len = sizeof(struct carl9170_probe_resp_rsp);
+	resp->probe_resp.addr = cpu_to_le32(super);
+	resp->probe_resp.len = cpu_to_le32(CARL9170_PROBE_RESP_BUFFER_LEN);
+	resp->probe_resp.enabled = cpu_to_le32(!!fw.wlan.probe_ssid[vif]);
+}
 
+static void wlan_probe_resp_done(void *_super, const bool success)
+{
+	const unsigned int vif = ((uint32_t *) _super -
+		dma_mem.reserved.probe.buf[0]) /
+		ARRAY_SIZE(dma_mem.reserved.probe.buf[0]);
+
+	if (!success)
+		fw.stats.probe_resp[vif].tx_failed++;
+}
+
+bool wlan_send_probe_resp(const unsigned int vif, const uint8_t *da)
+{
+	struct carl9170_tx_superframe *super = wlan_probe_resp_tmpl(vif);
+
+	/* the BlockAck and the previous response share the descriptor */
+	if (!fw.wlan.fw_desc_available)
+		return false;
+
+	memcpy(super->f.data.i3e.addr1, da, 6);
+
+	/* undo what the rate control did to the last response */
+	super->f.hdr.phy.set = fw.wlan.probe_phy[vif];
+	super->f.hdr.mac.erp_prot = super->s.ri[0].erp_prot;
+	super->f.data.i3e.frame_control &= cpu_to_le16(~IEEE80211_FCTL_RETRY);
+
+	wlan_tx_fw(&super->s, wlan_probe_resp_done);
+	return true;
+}
+#endif /* CONFIG_CARL9170FW_PROBE_RESP_OFFLOAD */
+
+#ifdef CONFIG_CARL9170FW_TX_FLOW
+void wlan_set_tx_flow(const unsigned int flow, const unsigned int flags,
+		      struct carl9170_rsp *resp)
+{
+	struct carl9170_tx_superframe *super = wlan_tx_flow_tmpl(flow);
+	const unsigned int len = le16_to_cpu(super->s.len);
+	const unsigned int hdr_len = len - sizeof(struct carl9170_tx_superdesc) -
+				     sizeof(struct ar9170_tx_hwdesc);
+
+	/* QoS 4-address header with HT control, LLC/SNAP */
+	BUILD_BUG_ON(CARL9170_TX_FLOW_BUFFER_LEN <
+		     sizeof(struct carl9170_tx_superdesc) +
+		     sizeof(struct ar9170_tx_hwdesc) + 36 + 8);
+	BUILD_BUG_ON(CARL9170_TX_FLOW_BUFFER_LEN > 0xff);
+
+	fw.wlan.tx_flow_len[flow] = 0;
+
+	if ((flags & CARL9170_TX_FLOW_ENABLE) &&
+	    len <= CARL9170_TX_FLOW_BUFFER_LEN &&
+	    len >= sizeof(struct carl9170_tx_superdesc) +
+		   sizeof(struct ar9170_tx_hwdesc) + 24 &&
+	    ieee80211_is_data(super->f.data.i3e.frame_control) &&
+	    hdr_len >= ieee80211_hdrlen(super->f.data.i3e.frame_control))
+		fw.wlan.tx_flow_len[flow] = len;
+
+	resp->hdr.len = sizeof(struct carl9170_tx_flow_rsp);
+	resp->tx_flow.addr = cpu_to_le32(super);
+	resp->tx_flow.len = cpu_to_le32(CARL9170_TX_FLOW_BUFFER_LEN);
+	resp->tx_flow.enabled = cpu_to_le32(!!fw.wlan.tx_flow_len[flow]);
+}
+
+/*
+ * Compact frames are expanded in place: the payload moves up to
+ * make room for the flow's template. Since the payload can't be
+ * spread over the next blocks, the result has to fit into the first.
+ */
+bool wlan_tx_expand(struct dma_desc *desc)
+{
+	struct carl9170_tx_compact_desc *compact = DESC_PAYLOAD(desc);
+	struct carl9170_tx_superframe *super = DESC_PAYLOAD(desc);
+	unsigned int len, tmpl_len, flow;
+	__le16 seq_ctrl;
+	uint8_t cookie;
+
+	if (likely(compact->marker != CARL9170_TX_COMPACT_MARKER))
+		return true;
+
+	flow = compact->flow;
+	len = le16_to_cpu(compact->len);
+	tmpl_len = flow < CARL9170_TX_FLOW_NUM ? fw.wlan.tx_flow_len[flow] : 0;
+
+	if (unlikely(!tmpl_len || desc->lastAddr != desc ||
+		     len < sizeof(*compact) + 1 ||
+		     tmpl_len + len - sizeof(*compact) > AR9170_BLOCK_SIZE)) {
+		/* no tries to report */
+		compact->marker = compact->flow = 0;
+		fw.stats.tx_flow.rejected++;
+		return false;
+	}
+
+	cookie = compact->cookie;
+	seq_ctrl = compact->seq_ctrl;
+	len -= sizeof(*compact);
+
+	memmove((uint8_t *) super + tmpl_len, compact + 1, len);
+	memcpy(super, wlan_tx_flow_tmpl(flow), tmpl_len);
+
+	super->s.len = cpu_to_le16(tmpl_len + len);
+	super->s.cookie = cookie;
+	super->f.hdr.length = cpu_to_le16(tmpl_len + len + FCS_LEN -
+		sizeof(struct carl9170_tx_superdesc) -
+		sizeof(struct ar9170_tx_hwdesc));
+	if (!super->s.assign_seq)
+		super->f.data.i3e.seq_ctrl = seq_ctrl;
+
+	desc->totalLen = desc->dataSize = tmpl_len + len;
+
+	fw.stats.tx_flow.expanded++;
+	fw.stats.tx_flow.saved_bytes += tmpl_len - sizeof(*compact);
+	return true;
+}
+#endif /* CONFIG_CARL9170FW_TX_FLOW */
+
+void wlan_send_buffered_cab(void)
+{
+	unsigned int i, armed;
+
+	/* only visit the vifs which have buffered traffic scheduled */
+	for (i = 0, armed = fw.wlan.cab_armed; armed; i++, armed >>= 1) {
+		if (likely(!(armed & 1)))
+			continue;
+
+		/*
+		 * This is hardcoded into carl9170usb driver.
+		 *
+		 * The driver must set the PRETBTT event to beacon_interval -
+		 * CARL9170_PRETBTT_KUS (usually 6) Kus.
+		 *
+		 * But still, we can only do so much about 802.11-2007 9.3.2.1 &
+		 * 11.2.1.6. Let's hope the current solution is adequate enough.
+		 */
+
+		if (is_after_msecs(fw.wlan.cab_flush_time[i], (CARL9170_TBTT_DELTA))) {
+			wlan_cab_flush_queue(i);
+
+			/*
+			 * This prevents the code from sending new BC/MC frames
+			 * which were queued after the previous buffered traffic
+			 * has been sent out... They will have to wait until the
+			 * next DTIM beacon comes along.
+			 */
+			fw.wlan.cab_flush_trigger[i] = CARL9170_CAB_TRIGGER_DEFER;
+			fw.wlan.cab_armed &= ~BIT(i);
+		}
 	}
 }
@@ -4590,6 +4590,11 @@ static inline bool is_multicast_ether_addr(const u8 *a)
         return 0x01 & a[0];
 }
 
+static inline bool is_broadcast_ether_addr(const u8 *a)
+{
+	return (a[0] & a[1] & a[2] & a[3] & a[4] & a[5]) == 0xff;
+}
+
 /**
  * _ieee80211_is_group_privacy_action - check if frame is a group addressed
  *	privacy action frame
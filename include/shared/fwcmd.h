@@ -57,6 +57,11 @@ enum carl9170_cmd_oids {
 	CARL9170_CMD_WOL		= 0x08,
 	CARL9170_CMD_TALLY		= 0x09,
 	CARL9170_CMD_WREGB		= 0x0a,
+	CARL9170_CMD_STATS		= 0x0b,
+	CARL9170_CMD_PARAM		= 0x0c,
+	CARL9170_CMD_PGEN		= 0x0d,
+	CARL9170_CMD_BCN_FILTER		= 0x0e,
+	CARL9170_CMD_MCAST_FILTER	= 0x0f,
 
 	/* CAM */
 	CARL9170_CMD_EKEY		= 0x10,
@@ -69,6 +74,16 @@ enum carl9170_cmd_oids {
 	CARL9170_CMD_FREQ_START		= 0x23,
 	CARL9170_CMD_PSM		= 0x24,
 
+	/* AP offloads */
+	CARL9170_CMD_PS_STA		= 0x30,
+	CARL9170_CMD_PROBE_RESP		= 0x31,
+
+	/* TX offloads */
+	CARL9170_CMD_TX_FLOW		= 0x38,
+	CARL9170_CMD_RATE_TBL		= 0x39,
+	CARL9170_CMD_AMSDU_STA		= 0x3a,
+	CARL9170_CMD_TXOP		= 0x3b,
+
 	/* Asychronous command flag */
 	CARL9170_CMD_ASYNC_FLAG		= 0x40,
 	CARL9170_CMD_WREG_ASYNC		= (CARL9170_CMD_WREG |
@@ -86,6 +101,7 @@ enum carl9170_cmd_oids {
 	CARL9170_RSP_TXCOMP		= 0xc1,
 	CARL9170_RSP_BEACON_CONFIG	= 0xc2,
 	CARL9170_RSP_ATIM		= 0xc3,
+	CARL9170_RSP_BEACON_TEMPLATE	= 0xc4,
 	CARL9170_RSP_WATCHDOG		= 0xc6,
 	CARL9170_RSP_TEXT		= 0xca,
 	CARL9170_RSP_HEXDUMP		= 0xcc,
@@ -184,6 +200,13 @@ struct carl9170_rx_filter_cmd {
 #define CARL9170_RX_FILTER_CTL_BACKR	0x20
 #define CARL9170_RX_FILTER_MGMT		0x40
 #define CARL9170_RX_FILTER_DATA		0x80
+#define CARL9170_RX_FILTER_DUPLICATE	0x100	/* retransmitted data frame */
+#define CARL9170_RX_FILTER_BCN_SAME	0x200	/* unchanged beacon of our BSS */
+#define CARL9170_RX_FILTER_MCAST_MISS	0x400	/* multicast DA not in the table */
+#define CARL9170_RX_FILTER_PS_DONE	0x800	/* PS-Poll/QoS Null trigger answered */
+#define CARL9170_RX_FILTER_PROBE_DONE	0x1000	/* probe request answered */
+#define CARL9170_RX_FILTER_CONGESTED	0x2000	/* data frame, upload backed up */
+#define CARL9170_RX_FILTER_LAST		CARL9170_RX_FILTER_CONGESTED	/* KEEP UPDATED */
 #define CARL9170_RX_FILTER_EVERYTHING	(~0)
 
 struct carl9170_bcn_ctrl_cmd {
@@ -196,6 +219,154 @@ struct carl9170_bcn_ctrl_cmd {
 
 #define CARL9170_BCN_CTRL_DRAIN	0
 #define CARL9170_BCN_CTRL_CAB_TRIGGER	1
+#define CARL9170_BCN_CTRL_TEMPLATE	2
+
+/*
+ * Beacons of the BSS (AR9170_MAC_REG_BSSID) are put into the
+ * CARL9170_RX_FILTER_BCN_SAME class, unless their IEs changed,
+ * the TIM indicates buffered traffic for aid (or multicast) or
+ * the last uploaded beacon is older than keepalive usecs.
+ * The TSF is never part of the comparison, the TIM only with
+ * CARL9170_BCN_FILTER_HASH_TIM.
+ */
+struct carl9170_bcn_filter_cmd {
+	__le32		flags;
+	__le32		aid;
+	__le32		keepalive;
+} __packed;
+#define CARL9170_BCN_FILTER_CMD_SIZE	12
+
+#define CARL9170_BCN_FILTER_HASH_TIM	1
+
+/*
+ * Replaces the table of accepted multicast addresses.
+ * Broadcast frames are always accepted. Commands, which are
+ * too short for count addresses, are ignored.
+ */
+#define CARL9170_MCAST_FILTER_NUM	8
+
+struct carl9170_mcast_filter_cmd {
+	__le32		count;
+	u8		addr[CARL9170_MCAST_FILTER_NUM][6];
+} __packed;
+#define CARL9170_MCAST_FILTER_CMD_SIZE	52
+
+/*
+ * Frames with the superdesc ps_sta field set to slot + 1 are
+ * held back in the firmware (one queue per AC), while a station
+ * with the given aid is set for the slot.
+ *
+ * Every PS-Poll from this aid releases the next held frame of the
+ * legacy ACs (with MOREDATA set, if there are more). A trigger frame
+ * from addr for one of the uapsd ACs (BIT(ar9170_txq)) starts a
+ * service period of up to max_sp (0 = all) frames of these ACs.
+ * The last one gets EOSP, if it is QoS data. Later triggers are
+ * ignored until this frame is done.
+ *
+ * An aid of 0 frees the slot and sends all held frames.
+ */
+struct carl9170_ps_sta_cmd {
+	__le32		sta;
+	__le32		aid;
+	__le32		uapsd;
+	__le32		max_sp;
+	u8		addr[6];
+	u8		padding[2];
+} __packed;
+#define CARL9170_PS_STA_CMD_SIZE	24
+
+/*
+ * The template is a superframe with a complete probe response,
+ * which is written to the vif's buffer the response points to.
+ * While it is enabled, the firmware answers all probe requests
+ * for the template's SSID (or the wildcard SSID) and BSSID on
+ * its own. The timestamp and the DA are filled in for each one.
+ */
+struct carl9170_probe_resp_cmd {
+	__le32		vif_id;
+	__le32		flags;
+} __packed;
+#define CARL9170_PROBE_RESP_CMD_SIZE	8
+
+#define CARL9170_PROBE_RESP_ENABLE	1
+
+struct carl9170_probe_resp_rsp {
+	__le32		addr;
+	__le32		len;
+	__le32		enabled;
+} __packed;
+#define CARL9170_PROBE_RESP_RSP_SIZE	12
+
+/*
+ * The template holds the superdesc, hwdesc, 802.11 header (and
+ * optionally the LLC/SNAP header) of a flow. It is written to the
+ * buffer the response points to; s.len is the template's length.
+ * Frames of the flow can then be sent with a short
+ * struct carl9170_tx_compact_desc in front of their payload.
+ *
+ * The buffer (rsp len) has room for a QoS 4-address header with HT
+ * control and LLC/SNAP. Longer templates and templates without a
+ * complete data frame header are rejected: enabled is 0 then.
+ */
+struct carl9170_tx_flow_cmd {
+	__le32		flow;
+	__le32		flags;
+} __packed;
+#define CARL9170_TX_FLOW_CMD_SIZE	8
+
+#define CARL9170_TX_FLOW_ENABLE		1
+
+struct carl9170_tx_flow_rsp {
+	__le32		addr;
+	__le32		len;
+	__le32		enabled;
+} __packed;
+#define CARL9170_TX_FLOW_RSP_SIZE	12
+
+/*
+ * Frames, which reference a table (CARL9170_TX_SUPER_RATE_TBL), take
+ * their rates, tries and protection from the table instead of their
+ * own superdesc and hwdesc. The ri AMPDU bit tells whether the rate
+ * can be aggregated, the frame's own ri[0] AMPDU bit still says if
+ * the frame belongs to a BlockAck session. A table with no tries
+ * for the first rate is unused; its frames keep their own rates.
+ */
+struct carl9170_rate_tbl_cmd {
+	__le32		idx;	/* 1 - CARL9170_RATE_TBL_NUM */
+	__le32		phy;	/* first rate, like the hwdesc */
+	u8		ri[4];	/* CARL9170_TX_SUPER_RI_* */
+	__le32		rr[3];	/* retry rates */
+} __packed;
+#define CARL9170_RATE_TBL_CMD_SIZE	24
+
+#define CARL9170_RATE_TBL_NUM		15
+
+/*
+ * Small QoS data frames for this RA are merged into A-MSDUs of up
+ * to max_len bytes (the peer's maximum A-MSDU length, 0 = off).
+ * Only frames with CARL9170_TX_SUPER_MISC_ASSIGN_SEQ are merged.
+ * The superdesc of a merged frame has the amsdu bit set. Older
+ * firmwares left that bit alone, so the host has to check for
+ * CARL9170FW_TX_AMSDU in the fwdesc before it looks at it.
+ */
+struct carl9170_amsdu_sta_cmd {
+	__le32		sta;
+	__le32		max_len;
+	u8		addr[6];
+	u8		padding[2];
+} __packed;
+#define CARL9170_AMSDU_STA_CMD_SIZE	16
+
+/*
+ * With a frame limit, the firmware cuts the queued frames of the AC
+ * into bursts of at most that many frames, which share one TXOP.
+ * The TXOP limits themselves (AR9170_MAC_REG_AC*_TXOP) are left to
+ * the host.
+ */
+struct carl9170_txop_cmd {
+	u8		frames[4];	/* index: ar9170_txq, 0 = up to the MAC */
+} __packed;
+#define CARL9170_TXOP_CMD_SIZE		4
 
 struct carl9170_wol_cmd {
 	__le32		flags;
@@ -212,6 +383,129 @@ struct carl9170_wol_cmd {
 #define CARL9170_WOL_DISCONNECT		1
 #define CARL9170_WOL_MAGIC_PKT		2
 
+struct carl9170_stats_cmd {
+	__le32		id;
+	__le32		index;
+} __packed;
+#define CARL9170_STATS_CMD_SIZE		8
+
+/*
+ * The template is a superframe (like the ones which are sent to
+ * the bulk endpoint). The response tells where it has to go.
+ * Intervals must stay below the ~48s clock counter wrap, or
+ * the generator is not started.
+ */
+struct carl9170_pgen_cmd {
+	__le32		flags;
+	__le32		count;		/* frames, 0 = until stopped */
+	__le32		interval;	/* usecs between frames, 0 = saturate */
+	__le32		size;		/* 802.11 frame length, 0 = keep template */
+	__le32		phy;		/* phy_control, 0 = keep template */
+} __packed;
+#define CARL9170_PGEN_CMD_SIZE		20
+
+#define CARL9170_PGEN_START		1
+
+struct carl9170_pgen_rsp {
+	__le32		addr;
+	__le32		len;
+	__le32		running;
+} __packed;
+#define CARL9170_PGEN_RSP_SIZE		12
+
+/*
+ * A command with only the id reads the parameter, one with
+ * id and value sets it. Unknown parameters and invalid values
+ * are answered with an empty response.
+ *
+ * The hang thresholds must stay in order (bump <= debug <= reset).
+ * Raise them starting with reset, lower them starting with bump.
+ */
+struct carl9170_param_cmd {
+	__le32		id;
+	__le32		value;
+} __packed;
+#define CARL9170_PARAM_CMD_SIZE		8
+
+enum carl9170_param_ids {
+	CARL9170_PARAM_HANG_BUMP_USECS	= 0,
+	CARL9170_PARAM_HANG_DEBUG_USECS	= 1,
+	CARL9170_PARAM_HANG_RESET_USECS	= 2,
+	CARL9170_PARAM_USB_LOOPBACK	= 3,	/* CARL9170_LOOPBACK_* flags */
+	CARL9170_PARAM_RX_TEST		= 4,	/* count and discard rx frames */
+	CARL9170_PARAM_RX_TRUNCATE	= 5,	/* rx upload length, 0 = off */
+	CARL9170_PARAM_RX_TSF		= 6,	/* CARL9170_RX_TSF_* */
+	CARL9170_PARAM_RX_DECAP		= 7,	/* see carl9170_rx_decap_hdr */
+
+	/* KEEP LAST */
+	__CARL9170_PARAM_NUM
+};
+
+/*
+ * USB loopback: frames from the host are sent straight back up
+ * instead of going out over the air. With CARL9170_LOOPBACK_STAMP,
+ * s.rr[0] is replaced by the clock counter at the time the frame
+ * was downloaded and s.rr[1] by the clock ticks per usec.
+ * CARL9170_LOOPBACK_STAMP has no effect without CARL9170_LOOPBACK_ENABLE.
+ */
+#define CARL9170_LOOPBACK_ENABLE	1
+#define CARL9170_LOOPBACK_STAMP		2
+
+/*
+ * RX truncation: longer frames are cut down to the first
+ * CARL9170_PARAM_RX_TRUNCATE (rounded down to a multiple of
+ * CARL9170_RX_TRUNCATE_ALIGN) bytes, followed by the original
+ * length as __le32 and the original phy/mac status tail.
+ */
+#define CARL9170_RX_TRUNCATE_ALIGN	4
+
+/*
+ * RX timestamps: evm_stream0[0-5] and evm_stream1[0-1] of the
+ * phy status (struct ar9170_rx_phystatus) are replaced by two
+ * __le32. The first is sampled once for all frames which are
+ * uploaded together, the second is the time from that sample
+ * to the upload of this frame. With CARL9170_RX_TSF_TSF, both
+ * are in usec (lower 32 bits of the TSF). With
+ * CARL9170_RX_TSF_CLOCK, both are in clock ticks (see
+ * carl9170_tally_rsp for the ticks per usec).
+ *
+ * Only single and last MPDUs (AR9170_RX_STATUS_MPDU_SINGLE and
+ * AR9170_RX_STATUS_MPDU_LAST) have a phy status and carry the
+ * stamp. The EVM values of these frames are lost.
+ */
+#define CARL9170_RX_TSF_OFF		0
+#define CARL9170_RX_TSF_TSF		1
+#define CARL9170_RX_TSF_CLOCK		2
+
+/* reset the statistics block after it was read */
+#define CARL9170_STATS_CLEAR		0x80000000
+
+enum carl9170_stats_ids {
+	CARL9170_STATS_CAB		= 0,	/* index: vif_id */
+	CARL9170_STATS_PROT		= 1,	/* index: tx queue */
+	CARL9170_STATS_HANG		= 2,	/* index: tx queue */
+	CARL9170_STATS_MAC_RESET	= 3,
+	CARL9170_STATS_PGEN		= 4,
+	CARL9170_STATS_LOOPBACK		= 5,
+	CARL9170_STATS_RX_TEST		= 6,
+	CARL9170_STATS_RX_RATES		= 7,	/* index: carl9170_rx_rate_class */
+	CARL9170_STATS_RX_FILTER	= 8,	/* index: CARL9170_RX_FILTER_* bit */
+	CARL9170_STATS_MCAST		= 9,
+	CARL9170_STATS_RX_STA		= 10,	/* index: table slot */
+	CARL9170_STATS_PS		= 11,	/* index: ps station slot */
+	CARL9170_STATS_PROBE_RESP	= 12,	/* index: vif_id */
+	CARL9170_STATS_RX_BALANCE	= 13,
+	CARL9170_STATS_RX_CONGESTION	= 14,
+	CARL9170_STATS_RX_DECAP		= 15,
+	CARL9170_STATS_TX_FLOW		= 16,
+	CARL9170_STATS_TX_AMSDU		= 17,
+	CARL9170_STATS_TXOP		= 18,
+	CARL9170_STATS_RX_STA_RATES	= 19,	/* index: table slot */
+
+	/* KEEP LAST */
+	__CARL9170_STATS_NUM
+};
+
 struct carl9170_cmd_head {
 	union {
 		struct {
@@ -239,6 +533,17 @@ struct carl9170_cmd {
 		struct carl9170_wol_cmd		wol;
 		struct carl9170_bcn_ctrl_cmd	bcn_ctrl;
 		struct carl9170_rx_filter_cmd	rx_filter;
+		struct carl9170_stats_cmd	stats;
+		struct carl9170_param_cmd	param;
+		struct carl9170_pgen_cmd	pgen;
+		struct carl9170_bcn_filter_cmd	bcn_filter;
+		struct carl9170_mcast_filter_cmd mcast_filter;
+		struct carl9170_ps_sta_cmd	ps_sta;
+		struct carl9170_probe_resp_cmd	probe_resp;
+		struct carl9170_tx_flow_cmd	tx_flow;
+		struct carl9170_rate_tbl_cmd	rate_tbl;
+		struct carl9170_amsdu_sta_cmd	amsdu_sta;
+		struct carl9170_txop_cmd	txop;
 		u8 data[CARL9170_MAX_CMD_PAYLOAD_LEN];
 	} __packed __aligned(4);
 } __packed __aligned(4);
@@ -312,6 +617,205 @@ struct carl9170_tally_rsp {
 	__le32 tick;
 } __packed;
 
+struct carl9170_cab_stats {
+	__le32 sent;		/* frames released after a DTIM beacon */
+	__le32 deferred;	/* frames which missed the DTIM they were queued for */
+	__le32 latency;		/* PRETBTT to last frame completed [usec] */
+	__le32 max_latency;
+} __packed;
+#define CARL9170_CAB_STATS_SIZE		16
+
+struct carl9170_prot_stats {
+	__le32 toggles;		/* protection was switched on or off */
+	__le32 tries;		/* retries without RTS/CTS */
+	__le32 failures;
+	__le32 prot_tries;	/* retries with RTS/CTS */
+	__le32 prot_failures;
+} __packed;
+#define CARL9170_PROT_STATS_SIZE	20
+
+struct carl9170_hang_stats {
+	__le32 hangs;		/* queue made no progress for HANG_BUMP_USECS */
+	__le32 resets;		/* ... for HANG_RESET_USECS */
+	__le32 hang_time;	/* last progress to recovery [usec] */
+	__le32 max_hang_time;
+	__le32 recovery_time;	/* detection to recovery [usec] */
+} __packed;
+#define CARL9170_HANG_STATS_SIZE	20
+
+enum carl9170_mac_reset_cause {
+	CARL9170_MAC_RESET_CAUSE_TX_HANG	= 0,
+	CARL9170_MAC_RESET_CAUSE_RX_OVERRUN	= 1,
+	CARL9170_MAC_RESET_CAUSE_HOST		= 2,
+
+	/* KEEP LAST */
+	__CARL9170_MAC_RESET_CAUSE_NUM
+};
+
+struct carl9170_mac_reset_stats {
+	__le32 resets[__CARL9170_MAC_RESET_CAUSE_NUM];
+	__le32 last_cause;
+	__le32 duration;	/* of the last reset [clock ticks] */
+	__le32 max_duration;
+} __packed;
+#define CARL9170_MAC_RESET_STATS_SIZE	24
+
+struct carl9170_pgen_stats {
+	__le32 queued;
+	__le32 completed;
+	__le32 failed;
+	__le32 tx_time;		/* [clock ticks] */
+	__le32 elapsed;		/* [clock ticks] */
+	__le32 tick;		/* clock ticks per usec */
+} __packed;
+#define CARL9170_PGEN_STATS_SIZE	24
+
+struct carl9170_loopback_stats {
+	__le32 frames;
+	__le32 bytes;
+} __packed;
+#define CARL9170_LOOPBACK_STATS_SIZE	8
+
+/*
+ * A frame is accounted in every filter class it belongs to,
+ * so the classes don't add up to the total number of frames.
+ */
+struct carl9170_rx_filter_stats {
+	__le32 dropped;
+	__le32 dropped_bytes;
+	__le32 passed;		/* uploaded to the host */
+	__le32 passed_bytes;
+} __packed;
+#define CARL9170_RX_FILTER_STATS_SIZE	16
+/* one per CARL9170_RX_FILTER_* bit, up to CARL9170_RX_FILTER_LAST */
+#define CARL9170_RX_FILTER_CLASSES	14
+
+/*
+ * Per transmitter rx statistics. Empty slots have a frame count
+ * of zero. The rate histogram of the same slot has the CCK rates
+ * first, followed by eight OFDM (PLCP rate & 7) and sixteen HT
+ * (MCS 0-15) buckets. Its counters wrap around. Clearing either
+ * block releases the whole slot, rate histogram included.
+ */
+#define CARL9170_RX_STA_RATES		28
+
+struct carl9170_rx_sta_stats {
+	u8 ta[6];
+	s8 rssi;		/* running average of rssi_combined [dB] */
+	u8 padding;
+	__le32 frames;
+	__le32 bytes;
+	__le32 last_seen;	/* [clock ticks] */
+} __packed;
+#define CARL9170_RX_STA_STATS_SIZE	20
+
+struct carl9170_rx_sta_rate_stats {
+	__le16 rates[CARL9170_RX_STA_RATES];
+} __packed;
+#define CARL9170_RX_STA_RATE_STATS_SIZE	56
+
+struct carl9170_ps_stats {
+	__le32 held;
+	__le32 released;	/* in response to a PS-Poll */
+	__le32 polls;
+	__le32 empty_polls;	/* nothing was held, left to the host */
+	__le32 latency;		/* PS-Poll to the first tx attempt [usec] */
+	__le32 max_latency;
+	__le32 service_periods;
+	__le32 sp_frames;	/* frames sent in all service periods */
+	__le32 empty_triggers;	/* nothing was held, left to the host */
+} __packed;
+#define CARL9170_PS_STATS_SIZE		36
+
+struct carl9170_probe_resp_stats {
+	__le32 requests;	/* for an interface with a template */
+	__le32 answered;
+	__le32 escalated;	/* left to the host */
+	__le32 tx_failed;
+} __packed;
+#define CARL9170_PROBE_RESP_STATS_SIZE	16
+
+struct carl9170_rx_balance_stats {
+	__le32 lent;		/* tx blocks in the rx pool right now */
+	__le32 max_lent;
+	__le32 lend_events;	/* blocks are taken as tx frames complete */
+	__le32 return_events;
+	__le32 lent_blocks;	/* over all lend events */
+	__le32 returned_blocks;
+	__le32 last_event;	/* [clock ticks] */
+	__le32 tick;		/* clock ticks per usec */
+} __packed;
+#define CARL9170_RX_BALANCE_STATS_SIZE	32
+
+struct carl9170_mcast_stats {
+	__le32 hits;		/* multicast data frames found in the table */
+	__le32 misses;
+} __packed;
+#define CARL9170_MCAST_STATS_SIZE	8
+
+struct carl9170_rx_congestion_stats {
+	__le32 dropped[4];	/* index: ar9170_txq of the frame's tid */
+	__le32 dropped_bytes;
+	__le32 kept;		/* Null data and EAPOL frames */
+	__le32 max_backlog;	/* rx frames waiting for the upload */
+} __packed;
+#define CARL9170_RX_CONGESTION_STATS_SIZE	28
+
+struct carl9170_rx_decap_stats {
+	__le32 frames;		/* converted */
+	__le32 skipped;		/* data frames, which were left alone */
+	__le32 saved_bytes;
+} __packed;
+#define CARL9170_RX_DECAP_STATS_SIZE	12
+
+struct carl9170_tx_flow_stats {
+	__le32 expanded;	/* compact frames */
+	__le32 rejected;	/* unknown flow or too long */
+	__le32 saved_bytes;
+} __packed;
+#define CARL9170_TX_FLOW_STATS_SIZE	12
+
+struct carl9170_tx_amsdu_stats {
+	__le32 merged;		/* A-MSDUs */
+	__le32 absorbed;	/* frames, which went into another's A-MSDU */
+	__le32 saved_bytes;	/* headers and FCS, less subframe headers */
+} __packed;
+#define CARL9170_TX_AMSDU_STATS_SIZE	12
+
+struct carl9170_txop_stats {
+	__le32 budgets[4];	/* index: ar9170_txq, frame limits started */
+	__le32 frames[4];	/* sent in these bursts */
+	__le32 qos_int;		/* AR9170_MAC_INT_QOS */
+} __packed;
+#define CARL9170_TXOP_STATS_SIZE	36
+
+struct carl9170_rx_test_stats {
+	__le32 frames;
+	__le32 bytes;		/* MPDU bytes of all intact frames */
+	__le32 fcs_errors;
+	__le32 plcp_errors;
+	__le32 elapsed;		/* time spent in rx test mode [clock ticks] */
+	__le32 tick;		/* clock ticks per usec */
+} __packed;
+#define CARL9170_RX_TEST_STATS_SIZE	24
+
+enum carl9170_rx_rate_class {
+	CARL9170_RX_RATE_CCK		= 0,	/* AR9170_TX_PHY_RATE_CCK_* */
+	CARL9170_RX_RATE_OFDM		= 1,	/* PLCP rate & 7 */
+	CARL9170_RX_RATE_HT		= 2,	/* MCS 0-7 */
+	CARL9170_RX_RATE_HT_2SS		= 3,	/* MCS 8-15, index: MCS & 7 */
+
+	/* KEEP LAST */
+	__CARL9170_RX_RATE_NUM
+};
+
+#define CARL9170_RX_RATES_NUM		8
+
+struct carl9170_rx_rate_stats {
+	__le32 frames[CARL9170_RX_RATES_NUM];
+} __packed;
+#define CARL9170_RX_RATE_STATS_SIZE	32
+
 struct carl9170_rsp {
 	struct carl9170_cmd_head hdr;
 
@@ -327,6 +831,15 @@ struct carl9170_rsp {
 		struct carl9170_tsf_rsp		tsf;
 		struct carl9170_psm		psm;
 		struct carl9170_tally_rsp	tally;
+		struct carl9170_cab_stats	cab_stats;
+		struct carl9170_prot_stats	prot_stats;
+		struct carl9170_hang_stats	hang_stats;
+		struct carl9170_mac_reset_stats	mac_reset_stats;
+		struct carl9170_pgen_stats	pgen_stats;
+		struct carl9170_pgen_rsp	pgen;
+		struct carl9170_probe_resp_rsp	probe_resp;
+		struct carl9170_tx_flow_rsp	tx_flow;
+		struct carl9170_param_cmd	param;
 		u8 data[CARL9170_MAX_CMD_PAYLOAD_LEN];
 	} __packed;
 } __packed __aligned(4);
@@ -75,6 +75,36 @@ enum carl9170fw_feature_list {
 	/* Pattern generator */
 	CARL9170FW_PATTERN_GENERATOR,
 
+	/* Firmware maintains the beacon | CARL9170_BCN_CTRL_TEMPLATE */
+	CARL9170FW_BEACON_TEMPLATE,
+
+	/* Firmware supports CARL9170_CMD_STATS */
+	CARL9170FW_STATS,
+
+	/* Firmware supports CARL9170_CMD_PARAM */
+	CARL9170FW_PARAMS,
+
+	/* Firmware can stamp rx frames | CARL9170_PARAM_RX_TSF */
+	CARL9170FW_RX_TSF,
+
+	/* Firmware supports CARL9170_CMD_PROBE_RESP */
+	CARL9170FW_PROBE_RESP_OFFLOAD,
+
+	/* Firmware can convert rx data frames | CARL9170_PARAM_RX_DECAP */
+	CARL9170FW_RX_DECAP,
+
+	/* Firmware supports CARL9170_CMD_TX_FLOW and compact tx frames */
+	CARL9170FW_TX_FLOW,
+
+	/* Firmware supports CARL9170_CMD_RATE_TBL */
+	CARL9170FW_RATE_TABLE,
+
+	/* Firmware merges small frames | CARL9170_CMD_AMSDU_STA */
+	CARL9170FW_TX_AMSDU,
+
+	/* Firmware supports CARL9170_CMD_TXOP */
+	CARL9170FW_TXOP_BURST,
+
 	/* KEEP LAST */
 	__CARL9170FW_FEATURE_NUM
 };
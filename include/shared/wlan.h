@@ -84,6 +84,8 @@
 #define	AR9170_RX_ERROR_WRONG_RA		0x10
 #define	AR9170_RX_ERROR_PLCP			0x20
 #define	AR9170_RX_ERROR_MMIC			0x40
+/* not an error: set by the firmware, see carl9170_rx_decap_hdr */
+#define	CARL9170_RX_ERROR_DECAP			0x80
 
 /* these are either-or */
 #define	AR9170_TX_MAC_PROT_RTS			0x0001
@@ -249,13 +251,14 @@ struct carl9170_tx_superdesc {
 	u8 ampdu_factor:2;
 	u8 ampdu_commit_density:1;
 	u8 ampdu_commit_factor:1;
-	u8 ampdu_unused_bit:1;
+	u8 amsdu:1;	/* merged by the firmware, see CARL9170FW_TX_AMSDU */
 	u8 queue:2;
 	u8 assign_seq:1;
 	u8 vif_id:3;
 	u8 fill_in_tsf:1;
 	u8 cab:1;
-	u8 padding2;
+	u8 ps_sta:4;
+	u8 rate_tbl:4;
 	struct ar9170_tx_rate_info ri[CARL9170_TX_MAX_RATES];
 	struct ar9170_tx_hw_phy_control rr[CARL9170_TX_MAX_RETRY_RATES];
 } __packed;
@@ -280,6 +283,12 @@ struct carl9170_tx_superframe {
 	struct ar9170_tx_frame f;
 } __packed __aligned(4);
 
+struct carl9170_rate_tbl {
+	struct ar9170_tx_hw_phy_control phy;
+	struct ar9170_tx_rate_info ri[CARL9170_TX_MAX_RATES];
+	struct ar9170_tx_hw_phy_control rr[CARL9170_TX_MAX_RETRY_RATES];
+} __packed;
+
 #endif /* __CARL9170FW__ */
 
 struct _ar9170_tx_hwdesc {
@@ -296,6 +305,9 @@ struct _ar9170_tx_hwdesc {
 #define	CARL9170_TX_SUPER_AMPDU_COMMIT_DENSITY_S	5
 #define	CARL9170_TX_SUPER_AMPDU_COMMIT_FACTOR		0x40
 #define	CARL9170_TX_SUPER_AMPDU_COMMIT_FACTOR_S		6
+/* only valid with CARL9170FW_TX_AMSDU in the fwdesc */
+#define	CARL9170_TX_SUPER_AMPDU_AMSDU			0x80
+#define	CARL9170_TX_SUPER_AMPDU_AMSDU_S			7
 
 #define CARL9170_TX_SUPER_MISC_QUEUE			0x3
 #define CARL9170_TX_SUPER_MISC_QUEUE_S			0
@@ -305,6 +317,11 @@ struct _ar9170_tx_hwdesc {
 #define	CARL9170_TX_SUPER_MISC_FILL_IN_TSF		0x40
 #define	CARL9170_TX_SUPER_MISC_CAB			0x80
 
+#define	CARL9170_TX_SUPER_PS_STA			0x0f	/* slot + 1 */
+#define	CARL9170_TX_SUPER_PS_STA_S			0
+#define	CARL9170_TX_SUPER_RATE_TBL			0xf0	/* table + 1 */
+#define	CARL9170_TX_SUPER_RATE_TBL_S			4
+
 #define CARL9170_TX_SUPER_RI_TRIES			0x7
 #define CARL9170_TX_SUPER_RI_TRIES_S			0
 #define CARL9170_TX_SUPER_RI_ERP_PROT			0x18
@@ -319,7 +336,7 @@ struct _carl9170_tx_superdesc {
 	u8 cookie;
 	u8 ampdu_settings;
 	u8 misc;
-	u8 padding;
+	u8 idx;		/* CARL9170_TX_SUPER_PS_STA and _RATE_TBL */
 	u8 ri[CARL9170_TX_MAX_RATES];
 	__le32 rr[CARL9170_TX_MAX_RETRY_RATES];
 } __packed;
@@ -335,6 +352,27 @@ struct _carl9170_tx_superframe {
 #define	CARL9170_TX_SUPERFRAME_LEN		(CARL9170_TX_SUPERDESC_LEN + \
 						 AR9170_TX_HWDESC_LEN)
 
+/*
+ * Replaces the superdesc, hwdesc and header of a frame, which is
+ * sent with the flow's template (CARL9170_CMD_TX_FLOW). len, cookie
+ * and misc (for the queue) are at the same place as in the superdesc.
+ * The firmware ignores the seq_ctrl, if the template has assign_seq.
+ */
+struct carl9170_tx_compact_desc {
+	__le16 len;
+	u8 marker;
+	u8 flow;
+	u8 cookie;
+	u8 padding;
+	u8 misc;
+	u8 padding2;
+	__le16 seq_ctrl;
+	__le16 padding3;
+} __packed;
+
+#define	CARL9170_TX_COMPACT_DESC_LEN		12
+#define	CARL9170_TX_COMPACT_MARKER		0xff	/* in place of rix */
+
 struct ar9170_rx_head {
 	u8 plcp[12];
 } __packed;
@@ -365,6 +403,32 @@ struct ar9170_rx_macstatus {
 
 #define	AR9170_RX_MACSTATUS_LEN			4
 
+/*
+ * RX decapsulation (CARL9170_PARAM_RX_DECAP): the 802.11 and LLC/SNAP
+ * headers of a converted data frame are replaced by this header and
+ * CARL9170_RX_ERROR_DECAP is set in its mac status. Only data frames,
+ * which are not fragmented, A-MSDUs or 4-address frames and which
+ * carry a RFC1042 or bridge tunnel SNAP header in the first rx block
+ * are converted. Protected frames are only converted, if the hardware
+ * has decrypted them. Their IV (4 bytes for WEP, 8 for TKIP and CCMP,
+ * see ar9170_get_decrypt_type) stays in front of this header and the
+ * MIC/ICV at the end of the payload.
+ *
+ * frame_control is the original one. qos_ctrl is 0 for non-QoS data
+ * frames. The transmitter is the SA, unless FROMDS is set (then it's
+ * the BSSID).
+ */
+struct carl9170_rx_decap_hdr {
+	__le16 frame_control;
+	__le16 seq_ctrl;
+	__le16 qos_ctrl;
+	u8 h_dest[6];
+	u8 h_source[6];
+	__be16 h_proto;
+} __packed;
+
+#define	CARL9170_RX_DECAP_HDR_LEN		20
+
 struct ar9170_rx_frame_single {
 	struct ar9170_rx_head phy_head;
 	struct ieee80211_hdr i3e __packed __aligned(2);
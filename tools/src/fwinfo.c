@@ -71,6 +71,16 @@ static const struct feature_list known_otus_features_v1[] = {
 	CHECK_FOR_FEATURE(CARL9170FW_RX_BA_FILTER),
 	CHECK_FOR_FEATURE(CARL9170FW_HAS_WREGB_CMD),
 	CHECK_FOR_FEATURE(CARL9170FW_PATTERN_GENERATOR),
+	CHECK_FOR_FEATURE(CARL9170FW_BEACON_TEMPLATE),
+	CHECK_FOR_FEATURE(CARL9170FW_STATS),
+	CHECK_FOR_FEATURE(CARL9170FW_PARAMS),
+	CHECK_FOR_FEATURE(CARL9170FW_RX_TSF),
+	CHECK_FOR_FEATURE(CARL9170FW_PROBE_RESP_OFFLOAD),
+	CHECK_FOR_FEATURE(CARL9170FW_RX_DECAP),
+	CHECK_FOR_FEATURE(CARL9170FW_TX_FLOW),
+	CHECK_FOR_FEATURE(CARL9170FW_RATE_TABLE),
+	CHECK_FOR_FEATURE(CARL9170FW_TX_AMSDU),
+	CHECK_FOR_FEATURE(CARL9170FW_TXOP_BURST),
 };
 
 static void check_feature_list(const struct carl9170fw_desc_head *head,